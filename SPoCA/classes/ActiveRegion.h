@@ -6,6 +6,7 @@
 #include <string>
 #include "EUVImage.h"
 #include "ColorMap.h"
+#include "aggregation.h"
 #include "Region.h"
 #include "RegionStats.h"
 #include "FitsFile.h"
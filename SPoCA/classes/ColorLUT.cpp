@@ -0,0 +1,70 @@
+#include "ColorLUT.h"
+
+#include "parallel.h"
+
+//!@file ColorLUT.cpp
+
+using namespace std;
+
+const unsigned ColorLUT::PAGE_BITS;
+const unsigned ColorLUT::PAGE_SIZE;
+const unsigned ColorLUT::NO_PAGE;
+
+//! Functor that applies a ColorLUT to the rows [beginRow, endRow) of a map
+class ColorLUTApplier
+{
+	private :
+		const ColorLUT& lut;
+		ColorType* pixels;
+		const unsigned xAxes;
+	public :
+		ColorLUTApplier(const ColorLUT& lut, ColorType* pixels, const unsigned xAxes)
+		:lut(lut), pixels(pixels), xAxes(xAxes)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			ColorType* end = pixels + endRow * xAxes;
+			for(ColorType* j = pixels + beginRow * xAxes; j < end; ++j)
+				*j = lut(*j);
+		}
+};
+
+ColorLUT::ColorLUT()
+:hasDefault(false), defaultColor(0)
+{}
+
+ColorLUT::ColorLUT(const ColorType defaultColor)
+:hasDefault(true), defaultColor(defaultColor)
+{}
+
+void ColorLUT::set(const ColorType color, const ColorType newColor)
+{
+	const unsigned page = color >> PAGE_BITS;
+	if(page >= pageIndex.size())
+		pageIndex.resize(page + 1, NO_PAGE);
+	if(pageIndex[page] == NO_PAGE)
+	{
+		// We allocate the page with the colors that have not been set
+		pageIndex[page] = pages.size();
+		const ColorType first = ColorType(page) << PAGE_BITS;
+		for(unsigned i = 0; i < PAGE_SIZE; ++i)
+			pages.push_back(unset(first + i));
+		defined.resize(pages.size(), false);
+	}
+	pages[pageIndex[page] + (color & (PAGE_SIZE - 1))] = newColor;
+	defined[pageIndex[page] + (color & (PAGE_SIZE - 1))] = true;
+}
+
+bool ColorLUT::contains(const ColorType color) const
+{
+	const unsigned page = color >> PAGE_BITS;
+	if(page >= pageIndex.size() || pageIndex[page] == NO_PAGE)
+		return false;
+	return defined[pageIndex[page] + (color & (PAGE_SIZE - 1))];
+}
+
+void ColorLUT::apply(ColorType* pixels, const unsigned xAxes, const unsigned yAxes) const
+{
+	ColorLUTApplier applier(*this, pixels, xAxes);
+	parallel_for_rows(yAxes, applier);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef ColorLUT_H
+#define ColorLUT_H
+
+#include <vector>
+
+#include "constants.h"
+
+//! Class that maps colors to new colors, with a table indexed by the color
+/*!
+The table has 2 levels: the high bits of a color give a page of the table, and the low bits the entry in the page.
+Only the pages of the colors that have been set are allocated, so the table stays small even for colors of 32 bits,
+and looking up a color costs 2 array accesses, instead of a search in a std::map or a std::set.
+
+The colors that have not been set are mapped to themselves, or to a default color if one is given to the constructor.
+The table is applied to the rows of a map in parallel (see parallel.h).
+*/
+
+class ColorLUT
+{
+	private :
+		//! Number of bits of the colors used for the entry in a page
+		static const unsigned PAGE_BITS = 12;
+
+		//! Number of entries of a page
+		static const unsigned PAGE_SIZE = 1 << PAGE_BITS;
+
+		//! Value of pageIndex for the pages that are not allocated
+		static const unsigned NO_PAGE = ~0U;
+
+		//! If the colors that have not been set are mapped to defaultColor, otherwise they are mapped to themselves
+		bool hasDefault;
+
+		//! Color of the colors that have not been set
+		ColorType defaultColor;
+
+		//! For each page, its index in pages or NO_PAGE
+		std::vector<unsigned> pageIndex;
+
+		//! The allocated pages, one after the other
+		std::vector<ColorType> pages;
+
+		//! For each entry of the pages, if the color has been set
+		std::vector<bool> defined;
+
+		//! Routine that returns the color for a color that has not been set
+		ColorType unset(const ColorType color) const
+		{return hasDefault ? defaultColor : color;}
+
+	public :
+		//! Constructor, the colors that have not been set are mapped to themselves
+		ColorLUT();
+
+		//! Constructor, the colors that have not been set are mapped to defaultColor
+		ColorLUT(const ColorType defaultColor);
+
+		//! Routine that maps color to newColor
+		void set(const ColorType color, const ColorType newColor);
+
+		//! Test if the color has been set
+		bool contains(const ColorType color) const;
+
+		//! Accessor to retrieve the new color of a color
+		ColorType operator()(const ColorType color) const
+		{
+			const unsigned page = color >> PAGE_BITS;
+			if(page >= pageIndex.size() || pageIndex[page] == NO_PAGE)
+				return unset(color);
+			return pages[pageIndex[page] + (color & (PAGE_SIZE - 1))];
+		}
+
+		//! Routine that replaces each pixel of the map of size xAxes x yAxes by its new color
+		void apply(ColorType* pixels, const unsigned xAxes, const unsigned yAxes) const;
+};
+
+#endif
@@ -4,6 +4,12 @@
 #include <math.h>
 #include <algorithm>
 
+#include "RemapTable.h"
+#include "distancetransform.h"
+#include "ConnectedComponents.h"
+#include "ColorLUT.h"
+#include "parallel.h"
+
 extern std::string filenamePrefix;
 
 using namespace std;
@@ -50,25 +56,7 @@ inline ColorType ColorMap::interpolate(float x, float y) const
 	
 	unsigned ix = (unsigned) x;
 	unsigned iy = (unsigned) y;
-	float dx = x - ix;
-	float dy = y - iy;
-	float cdx = 1. - dx;
-	float cdy = 1. - dy;
-	ColorType colors[] = {pixel(ix, iy), pixel(ix+1, iy), pixel(ix, iy+1), pixel(ix+1, iy+1)};
-	float quantity[] = {cdx*cdy, dx*cdy, cdx*dy, dx*dy};
-	
-	for(unsigned i = 0; i < 3; ++i)
-		for(unsigned j = i+1; j < 4; ++j)
-			if(colors[i] == colors[j])
-			{
-				quantity[i] += quantity[j];
-				quantity[j] = 0;
-			}
-	unsigned max = 0;
-	for(unsigned i = 1; i < 4; ++i)
-		max = quantity[i] > quantity[max] ? i : max;
-	
-	return colors[max];
+	return majority(pixels + iy * xAxes + ix, xAxes, x - ix, y - iy);
 }
 
 inline ColorType ColorMap::interpolate(const RealPixLoc& c) const
@@ -76,6 +64,28 @@ inline ColorType ColorMap::interpolate(const RealPixLoc& c) const
 	return interpolate(c.x, c.y);
 }
 
+void ColorMap::remapRows(const RemapTable* table, Image<ColorType>* image, const unsigned beginRow, const unsigned endRow) const
+{
+	const unsigned destinationXAxes = image->Xaxes();
+	const ColorType null = image->null();
+	for(unsigned y = beginRow; y < endRow; ++y)
+	{
+		ColorType* row = &(image->pixel(0, y));
+		const unsigned rowBegin = table->RowBegin(y);
+		const unsigned rowEnd = table->RowEnd(y);
+		fill(row, row + rowBegin, null);
+		for(unsigned x = rowBegin, j = y * destinationXAxes + rowBegin; x < rowEnd; ++x, ++j)
+		{
+			const unsigned index = table->sourceIndex(j);
+			if(index == RemapTable::NO_SOURCE)
+				row[x] = null;
+			else
+				row[x] = majority(pixels + index, xAxes, table->xWeight(j), table->yWeight(j));
+		}
+		fill(row + rowEnd, row + destinationXAxes, null);
+	}
+}
+
 void ColorMap::parseHeader()
 {
 	// We parse the header to extract the wcs coordinate system
@@ -186,12 +196,139 @@ bool isColorMap(const Header& header)
 	return header.has("INSTRUME") && header.get<string>("INSTRUME").find("SPoCA") != string::npos;
 }
 
+FitsFile& ColorMap::readFits(FitsFile& file)
+{
+	SunImage<ColorType>::readFits(file);
+	
+	// The colors of the map are replaced by the ones of the remap table, instead of rewriting the map when it is recolored
+	vector<ColorType> colors, newColors;
+	if(readColorRemap(file, colors, newColors))
+	{
+		remapColors(colors, newColors);
+		header.set("TRACKED", true, "Map has been tracked");
+	}
+	return file;
+}
+
+void ColorMap::remapColors(const vector<ColorType>& colors, const vector<ColorType>& newColors)
+{
+	ColorLUT colorTransfo;
+	for (unsigned c = 0; c < colors.size(); ++c)
+		colorTransfo.set(colors[c], newColors[c]);
+	colorTransfo.apply(pixels, xAxes, yAxes);
+}
+
+bool readColorRemap(FitsFile& file, vector<ColorType>& colors, vector<ColorType>& newColors)
+{
+	colors.clear();
+	newColors.clear();
+	if(! file.has("ColorRemap"))
+		return false;
+	
+	const int current_hdu = file.currentHDU();
+	file.moveTo("ColorRemap");
+	file.readColumn("COLOR", colors);
+	file.readColumn("NEW_COLOR", newColors);
+	file.moveTo(current_hdu);
+	if(colors.size() != newColors.size())
+	{
+		cerr<<"Error : the color remap table has columns of different sizes."<<endl;
+		colors.clear();
+		newColors.clear();
+		return false;
+	}
+	return true;
+}
+
+FitsFile& writeColorRemap(FitsFile& file, const vector<ColorType>& colors, const vector<ColorType>& newColors)
+{
+	// The table maps the colors of the pixels of the file, if it already has one we compose it with the new colors
+	vector<ColorType> fileColors, fileNewColors;
+	const bool remapped = readColorRemap(file, fileColors, fileNewColors);
+	if(remapped)
+	{
+		ColorLUT colorTransfo;
+		for (unsigned c = 0; c < colors.size(); ++c)
+			colorTransfo.set(colors[c], newColors[c]);
+		
+		// A color that no entry gives is the color of the pixels in the file, unless it is the color of an entry
+		ColorLUT fileColorTransfo;
+		for (unsigned c = 0; c < fileColors.size(); ++c)
+			fileColorTransfo.set(fileColors[c], fileNewColors[c]);
+		set<ColorType> givenColors(fileNewColors.begin(), fileNewColors.end());
+		for (unsigned c = 0; c < fileNewColors.size(); ++c)
+			fileNewColors[c] = colorTransfo(fileNewColors[c]);
+		for (unsigned c = 0; c < colors.size(); ++c)
+		{
+			if(givenColors.count(colors[c]) > 0)
+				continue;
+			if(fileColorTransfo.contains(colors[c]))
+			{
+				cerr<<"Error : the color "<<colors[c]<<" is not in the map, it is replaced by the color remap table."<<endl;
+				continue;
+			}
+			fileColors.push_back(colors[c]);
+			fileNewColors.push_back(newColors[c]);
+		}
+		file.moveTo("ColorRemap");
+	}
+	else
+	{
+		fileColors = colors;
+		fileNewColors = newColors;
+		file.writeTable("ColorRemap");
+	}
+	file.writeColumn("COLOR", fileColors, FitsFile::overwrite);
+	file.writeColumn("NEW_COLOR", fileNewColors, FitsFile::overwrite);
+	return file;
+}
+
 
 
+//! Routine that tells if the colors of the pixels are small enough to be used as index of a vector, and returns the greatest one
+static bool denseColors(const ColorType* pixels, const unsigned numberPixels, ColorType& maxColor)
+{
+	maxColor = 0;
+	for (const ColorType* j = pixels; j < pixels + numberPixels; ++j)
+		if(*j > maxColor)
+			maxColor = *j;
+	return maxColor < max(numberPixels, 65536U);
+}
+
 void ColorMap::thresholdRegionsByRawArea(const double minSize)
 {
 	const double pixelarea = PixelArea();
 	
+	ColorType maxColor;
+	if(denseColors(pixels, numberPixels, maxColor))
+	{
+		//First we compute the area for each color
+		vector<double> areas(maxColor + 1, 0.);
+		for (ColorType* j = pixels; j < pixels + numberPixels; ++j)
+		{
+			if(*j != nullpixelvalue)
+				areas[*j] += pixelarea;
+		}
+		#if defined VERBOSE
+		cout<<"Found following sizes for regions:"<<endl;
+		for(ColorType c = 0; c <= maxColor; ++c)
+		{
+			if(c != nullpixelvalue && areas[c] > 0)
+				cout<<"color: "<<c<<"\tsize:"<<areas[c]<<(areas[c] < minSize ? " To small" : " OK")<<endl;
+		}
+		#endif
+		//Now we nullify those that are too small, using a lookup table
+		vector<char> small(maxColor + 1);
+		for(ColorType c = 0; c <= maxColor; ++c)
+			small[c] = areas[c] < minSize;
+		for (ColorType* j = pixels; j < pixels + numberPixels; ++j)
+		{
+			if(*j != nullpixelvalue && small[*j])
+				*j = nullpixelvalue;
+		}
+		return;
+	}
+	
 	//First we compute the area for each color
 	map<ColorType,double> areas;
 	for (ColorType* j = pixels; j < pixels + numberPixels; ++j)
@@ -227,6 +364,36 @@ void ColorMap::thresholdRegionsByRealArea(double minSize)
 	//minSize is given as a number of pixels so we convert to Mm2
 	minSize *= RealPixelArea(wcs.sun_center);
 	
+	ColorType maxColor;
+	if(denseColors(pixels, numberPixels, maxColor))
+	{
+		//We compute the area for each color
+		vector<Real> areas(maxColor + 1, 0.);
+		for (Enumerator2D<ColorType> j = enumerator2D(); j.valid(); ++j)
+		{
+			if(*j != nullpixelvalue)
+				areas[*j] += RealPixelArea(j.coordinate());
+		}
+		#if defined VERBOSE
+		cout<<"Found following sizes for regions:"<<endl;
+		for(ColorType c = 0; c <= maxColor; ++c)
+		{
+			if(c != nullpixelvalue && areas[c] > 0)
+				cout<<"color: "<<c<<"\tsize:"<<areas[c]<<(areas[c] < minSize ? " To small" : " OK")<<endl;
+		}
+		#endif
+		//Now we nullify those that are too small, using a lookup table
+		vector<char> small(maxColor + 1);
+		for(ColorType c = 0; c <= maxColor; ++c)
+			small[c] = areas[c] < minSize;
+		for (ColorType* j = pixels; j < pixels + numberPixels; ++j)
+		{
+			if(*j != nullpixelvalue && small[*j])
+				*j = nullpixelvalue;
+		}
+		return;
+	}
+	
 	//We compute the area for each color
 	map<ColorType,Real> areas;
 	
@@ -369,9 +536,9 @@ ColorMap* ColorMap::erodeDiamond(unsigned size, ColorType pixelValueToErode)
 
 
 
-ColorMap* ColorMap::dilateCircular(const Real size, const ColorType unsetValue)
+ColorMap* ColorMap::dilateCircularByStamping(const Real size, const ColorType unsetValue)
 {
-	ColorType * newPixels = new ColorType[numberPixels];
+	ColorType * newPixels = allocatePixels(numberPixels);
 	memcpy(newPixels, pixels, numberPixels * sizeof(ColorType));
 	vector<int> shape;
 	shape.reserve(unsigned(size*size*3));
@@ -411,16 +578,16 @@ ColorMap* ColorMap::dilateCircular(const Real size, const ColorType unsetValue)
 		offset+=2;
 	}
 	
-	delete[] pixels;
+	releasePixels(pixels, numberPixels);
 	pixels = newPixels;
 	return this;
 }
 
 
 
-ColorMap* ColorMap::erodeCircular(const Real size, const ColorType unsetValue)
+ColorMap* ColorMap::erodeCircularByStamping(const Real size, const ColorType unsetValue)
 {
-	ColorType * newPixels = new ColorType[numberPixels];
+	ColorType * newPixels = allocatePixels(numberPixels);
 	memcpy(newPixels, pixels, numberPixels * sizeof(ColorType));
 	vector<int> shape;
 	shape.reserve(unsigned(size*size*3));
@@ -459,11 +626,207 @@ ColorMap* ColorMap::erodeCircular(const Real size, const ColorType unsetValue)
 		offset+=2;
 	}
 	
-	delete[] pixels;
+	releasePixels(pixels, numberPixels);
 	pixels = newPixels;
 	return this;
 }
 
+//! Buffers of the distance transforms of the circular morphology, that are reused by the successive operations of a closing
+class MorphologyBuffers
+{
+	public :
+		//! The sources, with the margins
+		vector<unsigned char> mask;
+		
+		//! The squared distances, with the margins
+		vector<unsigned> distance;
+};
+
+//! Routine that computes which pixels of a map of size xAxes x yAxes are at a squared distance smaller or equal than maxDistance of one of the sources
+/*!
+To give the same result as drawing the disc with offsets of the pixel index, the parts of the disc that go beyond the left or right side of the map
+continue on the other side, one row above or below. This is done by adding a copy of the sources near the sides, shifted by one row, beyond the other side.
+The radius of the disc must be smaller than xAxes.
+*/
+static void coveredPixels(const unsigned xAxes, const unsigned yAxes, const vector<unsigned>& sources, const unsigned maxDistance, vector<unsigned char>& covered, MorphologyBuffers& buffers)
+{
+	unsigned radius = 0;
+	while((radius + 1) * (radius + 1) <= maxDistance)
+		++radius;
+	
+	// We add margins only if some disc goes beyond the sides
+	unsigned margin = 0;
+	for(unsigned s = 0; s < sources.size() && margin == 0; ++s)
+		if(sources[s] % xAxes < radius || sources[s] % xAxes + radius >= xAxes)
+			margin = radius;
+	
+	const unsigned width = xAxes + 2 * margin;
+	vector<unsigned char>& mask = buffers.mask;
+	mask.assign(width * yAxes, 0);
+	for(unsigned s = 0; s < sources.size(); ++s)
+	{
+		unsigned x = sources[s] % xAxes;
+		unsigned y = sources[s] / xAxes;
+		mask[y * width + x + margin] = 1;
+		if(x < radius && y > 0)
+			mask[(y - 1) * width + x + xAxes + margin] = 1;
+		if(x + radius >= xAxes && y + 1 < yAxes)
+			mask[(y + 1) * width + x + margin - xAxes] = 1;
+	}
+	
+	vector<unsigned>& distance = buffers.distance;
+	distance.resize(width * yAxes);
+	squaredDistanceTransform(width, yAxes, &(mask[0]), &(distance[0]));
+	
+	covered.resize(xAxes * yAxes);
+	for(unsigned y = 0, j = 0; y < yAxes; ++y)
+	{
+		const unsigned* row = &(distance[y * width + margin]);
+		for(unsigned x = 0; x < xAxes; ++x, ++j)
+			covered[j] = row[x] <= maxDistance;
+	}
+}
+
+ColorMap* ColorMap::dilateCircular(const Real size, const ColorType unsetValue)
+{
+	if(xAxes < 3 || yAxes < 3)
+		return this;
+	
+	// The sources are the pixels of the contours, that have a neighbour unset
+	vector<unsigned> sources;
+	bool oneColor = true;
+	for(unsigned y = 1; y < yAxes - 1; ++y)
+	{
+		for(unsigned x = 1, j = y * xAxes + 1; x < xAxes - 1; ++x, ++j)
+		{
+			if(pixels[j] != unsetValue && (pixels[j-1] == unsetValue || pixels[j+1] == unsetValue || pixels[j-xAxes] == unsetValue || pixels[j+xAxes] == unsetValue))
+			{
+				if(! sources.empty() && pixels[j] != pixels[sources[0]])
+					oneColor = false;
+				sources.push_back(j);
+			}
+		}
+	}
+	if(sources.empty())
+		return this;
+	
+	const unsigned maxDistance = maximalSquaredDistance(size);
+	
+	// When the discs of several colors overlap, the color of the last pixel of the contours wins, that a distance transform cannot tell
+	if(! oneColor || maxDistance >= xAxes * xAxes)
+		return dilateCircularByStamping(size, unsetValue);
+	
+	vector<unsigned char> covered;
+	MorphologyBuffers buffers;
+	coveredPixels(xAxes, yAxes, sources, maxDistance, covered, buffers);
+	const ColorType color = pixels[sources[0]];
+	for(unsigned j = 0; j < numberPixels; ++j)
+		if(covered[j])
+			pixels[j] = color;
+	
+	return this;
+}
+
+ColorMap* ColorMap::erodeCircular(const Real size, const ColorType unsetValue)
+{
+	if(xAxes < 3 || yAxes < 3)
+		return this;
+	
+	const unsigned maxDistance = maximalSquaredDistance(size);
+	if(maxDistance >= xAxes * xAxes)
+		return erodeCircularByStamping(size, unsetValue);
+	
+	// The sources are the pixels of the contours, that have a neighbour of a different color
+	vector<unsigned> sources;
+	for(unsigned y = 1; y < yAxes - 1; ++y)
+	{
+		for(unsigned x = 1, j = y * xAxes + 1; x < xAxes - 1; ++x, ++j)
+		{
+			if(pixels[j] != unsetValue && (pixels[j-1] != pixels[j] || pixels[j+1] != pixels[j] || pixels[j-xAxes] != pixels[j] || pixels[j+xAxes] != pixels[j]))
+				sources.push_back(j);
+		}
+	}
+	if(sources.empty())
+		return this;
+	
+	vector<unsigned char> covered;
+	MorphologyBuffers buffers;
+	coveredPixels(xAxes, yAxes, sources, maxDistance, covered, buffers);
+	for(unsigned j = 0; j < numberPixels; ++j)
+		if(covered[j])
+			pixels[j] = unsetValue;
+	
+	return this;
+}
+
+//! Routine that returns the pixels of the contours of a binary map, that are set and have a neighbour not set
+/*! Like for the sources of dilateCircular and erodeCircular, the pixels on the sides of the map are not considered */
+static void contourPixels(const unsigned xAxes, const unsigned yAxes, const vector<unsigned char>& set, vector<unsigned>& sources)
+{
+	sources.clear();
+	for(unsigned y = 1; y < yAxes - 1; ++y)
+	{
+		for(unsigned x = 1, j = y * xAxes + 1; x < xAxes - 1; ++x, ++j)
+		{
+			if(set[j] && (! set[j-1] || ! set[j+1] || ! set[j-xAxes] || ! set[j+xAxes]))
+				sources.push_back(j);
+		}
+	}
+}
+
+ColorMap* ColorMap::closeCircular(const Real cleaningSize, const Real aggregationSize, const ColorType unsetValue)
+{
+	const Real sizes[] = {cleaningSize, cleaningSize + aggregationSize, aggregationSize};
+	
+	// The operations can be done on a binary map only if the pixels that are set have all the same color
+	bool binary = xAxes >= 3 && yAxes >= 3;
+	for(unsigned s = 0; s < 3 && binary; ++s)
+		if(maximalSquaredDistance(sizes[s]) >= xAxes * xAxes)
+			binary = false;
+	ColorType color = unsetValue;
+	for(unsigned j = 0; j < numberPixels && binary; ++j)
+	{
+		if(pixels[j] != unsetValue)
+		{
+			if(color == unsetValue)
+				color = pixels[j];
+			else if(pixels[j] != color)
+				binary = false;
+		}
+	}
+	if(! binary || color == unsetValue)
+	{
+		erodeCircular(cleaningSize, unsetValue);
+		dilateCircular(cleaningSize + aggregationSize, unsetValue);
+		return erodeCircular(aggregationSize, unsetValue);
+	}
+	
+	vector<unsigned char> set(numberPixels);
+	for(unsigned j = 0; j < numberPixels; ++j)
+		set[j] = pixels[j] != unsetValue;
+	
+	// The 3 operations share the buffers, and only the binary map is modified
+	vector<unsigned> sources;
+	vector<unsigned char> covered;
+	MorphologyBuffers buffers;
+	for(unsigned s = 0; s < 3; ++s)
+	{
+		contourPixels(xAxes, yAxes, set, sources);
+		if(sources.empty())
+			continue;
+		coveredPixels(xAxes, yAxes, sources, maximalSquaredDistance(sizes[s]), covered, buffers);
+		// The second operation is a dilation, the others are erosions
+		const unsigned char value = s == 1 ? 1 : 0;
+		for(unsigned j = 0; j < numberPixels; ++j)
+			if(covered[j])
+				set[j] = value;
+	}
+	
+	for(unsigned j = 0; j < numberPixels; ++j)
+		pixels[j] = set[j] ? color : unsetValue;
+	return this;
+}
+
 vector<HCC> ColorMap::get_half_circle(Real size)
 {
 	vector<HCC> line;
@@ -507,52 +870,150 @@ vector<PixLoc> ColorMap::get_shape(PixLoc center, const vector<HCC>& line)
 	return shape;
 }
 
-ColorMap* ColorMap::dilateCircularProjected(const Real size, const ColorType unsetValue)
+//! Horizontal span [xBegin, xEnd) of the row y of a projected shape, to be drawn with color
+struct ShapeSpan
 {
-	ColorType* original = new ColorType[numberPixels];
-	memcpy(original, pixels, numberPixels * sizeof(ColorType));
-	vector<HCC> line = get_half_circle(size);
-	
-	// We need to temporarly disable b0
-	Real cos_b0 = wcs.cos_b0;
-	Real sin_b0 = wcs.sin_b0;
-	wcs.cos_b0 = 1;
-	wcs.sin_b0 = 0;
-	RealPixLoc sun_center = SunCenter();
-	Real sun_radius = SunRadius();
+	unsigned y;
+	unsigned xBegin;
+	unsigned xEnd;
+	ColorType color;
+};
+
+//! Routine that appends to spans the rows of the shape around center, i.e. the pixels of ColorMap::get_shape
+/*!
+The rows that get_shape would put outside of the map are dropped or cut.
+The rotation is computed for each center: the latitude of the pixels of a row is not constant, because toHCC is not an orthographic projection,
+so the rotated half circle of a pixel can not be reused by its neighbours without changing the shapes.
+The cost of a center is 2 conversions per point of the half circle, instead of one per pixel of the shape with get_shape.
+*/
+static void projectedShape(const ColorMap* map, const PixLoc& center, const vector<HCC>& line, const ColorType color, vector<ShapeSpan>& spans)
+{
+	HGS hgs = map->toHGS(center);
+	if(! hgs)
+	{
+		return;
+	}
+	// The rotation matrix is such that we need to invert THE latitude
+	double sin_lat = sin(-hgs.latitude);
+	double cos_lat = cos(-hgs.latitude);
+	double sin_long = sin(hgs.longitude);
+	double cos_long = cos(hgs.longitude);
 	
-	unsigned min_y = ceil(sun_center.y - sun_radius);
-	unsigned max_y = floor(sun_center.y + sun_radius);
-	for(unsigned y = min_y; y <= max_y; ++y)
+	ShapeSpan span;
+	span.color = color;
+	for (unsigned i = 0; i < line.size(); ++i)
 	{
-		Real delta_x = sqrt(sun_radius * sun_radius - (y - sun_center.y) * (y - sun_center.y));
-		unsigned min_x = ceil(sun_center.x - delta_x);
-		unsigned max_x = floor(sun_center.x + delta_x);
-		ColorType* j = original + y * xAxes + min_x;
-		for(unsigned x = min_x; x <= max_x; ++x, ++j)
+		// We rotate around the x axis, x stays the same
+		double y = line[i].y * cos_lat - line[i].z * sin_lat;
+		double z = line[i].y * sin_lat + line[i].z * cos_lat;
+		// We rotate around the y axis, y stays the same
+		RealPixLoc max = map->toRealPixLoc(HCC(line[i].x * cos_long + sin_long * z, y, -line[i].x * sin_long + cos_long * z));
+		RealPixLoc min = map->toRealPixLoc(HCC(-line[i].x * cos_long + sin_long * z, y, line[i].x * sin_long + cos_long * z));
+		Real row = round(min.y);
+		Real xBegin = round(min.x);
+		Real xEnd = round(max.x) + 1;
+		// Like in get_shape, a negative start gives an empty row
+		if(! (row >= 0 && row < map->Yaxes() && xBegin >= 0 && xBegin < xEnd && xBegin < map->Xaxes()))
+			continue;
+		span.y = unsigned(row);
+		span.xBegin = unsigned(xBegin);
+		span.xEnd = xEnd < map->Xaxes() ? unsigned(xEnd) : map->Xaxes();
+		spans.push_back(span);
+	}
+}
+
+//! Functor that computes the shapes around the pixels of the contours in the rows [beginRow, endRow), for the projected morphology
+/*! For the dilation the contours are the set pixels next to an unset pixel, for the erosion the unset pixels next to a set pixel */
+class ProjectedContourShapes
+{
+	private :
+		const ColorMap* map;
+		const ColorType* original;
+		const vector<HCC>& line;
+		const ColorType unsetValue;
+		const bool erosion;
+		vector< vector<ShapeSpan> >& shapes;
+	public :
+		ProjectedContourShapes(const ColorMap* map, const ColorType* original, const vector<HCC>& line, const ColorType unsetValue, const bool erosion, vector< vector<ShapeSpan> >& shapes)
+		:map(map), original(original), line(line), unsetValue(unsetValue), erosion(erosion), shapes(shapes)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
 		{
-			if(*j != unsetValue)
+			const unsigned xAxes = map->Xaxes();
+			const unsigned yAxes = map->Yaxes();
+			RealPixLoc sun_center = map->SunCenter();
+			Real sun_radius = map->SunRadius();
+			
+			unsigned min_y = ceil(sun_center.y - sun_radius);
+			unsigned max_y = floor(sun_center.y + sun_radius);
+			// The first and last rows have no neighbours above or below
+			for(unsigned y = std::max(std::max(beginRow, min_y), 1U); y < endRow && y <= max_y && y + 1 < yAxes; ++y)
 			{
-				if(*(j-1) == unsetValue || *(j+1) == unsetValue || *(j-xAxes) == unsetValue || *(j+xAxes) == unsetValue)
+				Real delta_x = sqrt(sun_radius * sun_radius - (y - sun_center.y) * (y - sun_center.y));
+				unsigned min_x = ceil(sun_center.x - delta_x);
+				unsigned max_x = floor(sun_center.x + delta_x);
+				if(max_x >= xAxes)
+					max_x = xAxes - 1;
+				const ColorType* j = original + y * xAxes + min_x;
+				for(unsigned x = min_x; x <= max_x; ++x, ++j)
 				{
-					vector<PixLoc> shape = get_shape(PixLoc(x, y), line);
-					for (vector<PixLoc>::iterator s = shape.begin() ; s != shape.end(); ++s)
-					{
-						pixel(*s) = *j;
-					}
+					bool contour;
+					if(erosion)
+						contour = *j == unsetValue && (*(j-1) != unsetValue || *(j+1) != unsetValue || *(j-xAxes) != unsetValue || *(j+xAxes) != unsetValue);
+					else
+						contour = *j != unsetValue && (*(j-1) == unsetValue || *(j+1) == unsetValue || *(j-xAxes) == unsetValue || *(j+xAxes) == unsetValue);
+					if(contour)
+						projectedShape(map, PixLoc(x, y), line, *j, shapes[y]);
 				}
 			}
 		}
-	}
-	wcs.cos_b0 = cos_b0;
-	wcs.sin_b0 = sin_b0;
-	delete[] original;
-	return this;
+};
+
+//! Routine that sorts the spans of the shapes by their row y, the spans of row y are spans[rowBegin[y]] to spans[rowBegin[y + 1] - 1]
+/*! The sort is stable, so the spans of a row stay in the order of their contour pixel */
+static void spansByRow(const vector< vector<ShapeSpan> >& shapes, const unsigned yAxes, vector<ShapeSpan>& spans, vector<unsigned>& rowBegin)
+{
+	rowBegin.assign(yAxes + 1, 0);
+	for(unsigned y = 0; y < shapes.size(); ++y)
+		for(vector<ShapeSpan>::const_iterator s = shapes[y].begin(); s != shapes[y].end(); ++s)
+			++rowBegin[s->y + 1];
+	for(unsigned y = 0; y < yAxes; ++y)
+		rowBegin[y + 1] += rowBegin[y];
+	
+	spans.resize(rowBegin[yAxes]);
+	vector<unsigned> next(rowBegin.begin(), rowBegin.end() - 1);
+	for(unsigned y = 0; y < shapes.size(); ++y)
+		for(vector<ShapeSpan>::const_iterator s = shapes[y].begin(); s != shapes[y].end(); ++s)
+			spans[next[s->y]++] = *s;
 }
 
-ColorMap* ColorMap::erodeCircularProjected(const Real size, const ColorType unsetValue)
+//! Functor that draws the spans of the rows [beginRow, endRow) of the map, sorted by row with spansByRow
+/*! The spans of a row are drawn in the order of their contour pixel, so where they overlap the last one is kept */
+class ProjectedShapesDrawer
+{
+	private :
+		ColorType* pixels;
+		const unsigned xAxes;
+		const vector<ShapeSpan>& spans;
+		const vector<unsigned>& rowBegin;
+	public :
+		ProjectedShapesDrawer(ColorType* pixels, const unsigned xAxes, const vector<ShapeSpan>& spans, const vector<unsigned>& rowBegin)
+		:pixels(pixels), xAxes(xAxes), spans(spans), rowBegin(rowBegin)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			for(unsigned y = beginRow; y < endRow; ++y)
+			{
+				ColorType* row = pixels + y * xAxes;
+				for(unsigned s = rowBegin[y]; s < rowBegin[y + 1]; ++s)
+					fill(row + spans[s].xBegin, row + spans[s].xEnd, spans[s].color);
+			}
+		}
+};
+
+ColorMap* ColorMap::morphologyCircularProjected(const Real size, const ColorType unsetValue, const bool erosion)
 {
-	ColorType* original = new ColorType[numberPixels];
+	ColorType* original = allocatePixels(numberPixels);
 	memcpy(original, pixels, numberPixels * sizeof(ColorType));
 	vector<HCC> line = get_half_circle(size);
 	
@@ -561,35 +1022,38 @@ ColorMap* ColorMap::erodeCircularProjected(const Real size, const ColorType unse
 	Real sin_b0 = wcs.sin_b0;
 	wcs.cos_b0 = 1;
 	wcs.sin_b0 = 0;
-	RealPixLoc sun_center = SunCenter();
-	Real sun_radius = SunRadius();
 	
-	unsigned min_y = ceil(sun_center.y - sun_radius);
-	unsigned max_y = floor(sun_center.y + sun_radius);
-	for(unsigned y = min_y; y <= max_y; ++y)
-	{
-		Real delta_x = sqrt(sun_radius * sun_radius - (y - sun_center.y) * (y - sun_center.y));
-		unsigned min_x = ceil(sun_center.x - delta_x);
-		unsigned max_x = floor(sun_center.x + delta_x);
-		ColorType* j = original + y * xAxes + min_x;
-		for(unsigned x = min_x; x <= max_x; ++x, ++j)
-		{
-			if(*j == unsetValue && (*(j-1) != unsetValue || *(j+1) != unsetValue || *(j-xAxes) != unsetValue || *(j+xAxes) != unsetValue))
-			{
-				vector<PixLoc> shape = get_shape(PixLoc(x, y), line);
-				for (vector<PixLoc>::iterator s = shape.begin() ; s != shape.end(); ++s)
-				{
-					pixel(*s) = unsetValue;
-				}
-			}
-		}
-	}
+	// The shapes of the contour pixels of each row are computed in parallel
+	vector< vector<ShapeSpan> > shapes(yAxes);
+	ProjectedContourShapes contourShapes(this, original, line, unsetValue, erosion, shapes);
+	parallel_for_rows(yAxes, contourShapes);
+	
 	wcs.cos_b0 = cos_b0;
 	wcs.sin_b0 = sin_b0;
-	delete[] original;
+	releasePixels(original, numberPixels);
+	
+	// The spans are sorted by row, so that each tile of rows only draws its own spans
+	vector<ShapeSpan> spans;
+	vector<unsigned> rowBegin;
+	spansByRow(shapes, yAxes, spans, rowBegin);
+	vector< vector<ShapeSpan> >().swap(shapes);
+	
+	// The shapes have the color of their contour pixel, i.e. the unset value for the erosion
+	ProjectedShapesDrawer drawer(pixels, xAxes, spans, rowBegin);
+	parallel_for_rows(yAxes, drawer);
 	return this;
 }
 
+ColorMap* ColorMap::dilateCircularProjected(const Real size, const ColorType unsetValue)
+{
+	return morphologyCircularProjected(size, unsetValue, false);
+}
+
+ColorMap* ColorMap::erodeCircularProjected(const Real size, const ColorType unsetValue)
+{
+	return morphologyCircularProjected(size, unsetValue, true);
+}
+
 
 ColorMap* ColorMap::drawInternContours(const unsigned width, const ColorType unsetValue)
 {
@@ -629,7 +1093,7 @@ ColorMap* ColorMap::drawContours(const unsigned width, const ColorType unsetValu
 	if (size <= 0)
 		size = 1;
 	
-	ColorType * newPixels = new ColorType[numberPixels];
+	ColorType * newPixels = allocatePixels(numberPixels);
 	memcpy(newPixels, pixels, numberPixels * sizeof(ColorType));
 	vector<unsigned> shape;
 	shape.reserve(size*size*3);
@@ -675,7 +1139,7 @@ ColorMap* ColorMap::drawContours(const unsigned width, const ColorType unsetValu
 		}
 	}
 	
-	delete[] pixels;
+	releasePixels(pixels, numberPixels);
 	pixels = newPixels;
 	return this;
 }
@@ -683,53 +1147,41 @@ ColorMap* ColorMap::drawContours(const unsigned width, const ColorType unsetValu
 
 unsigned ColorMap::colorizeConnectedComponents(const ColorType setValue)
 {
-	ColorType color = setValue;
+	ConnectedComponents components(pixels, xAxes, yAxes, setValue);
 	for (unsigned j = 0; j < numberPixels; ++j)
 	{
-		if(pixels[j] == setValue)
-		{
-			++color;
-			propagateColor(color, j);
-		}
+		if(components.label(j) != 0)
+			pixels[j] = setValue + components.label(j);
 	}
 
-	return unsigned(color - setValue);
+	return components.NumberComponents();
 
 }
 
 
 void ColorMap::recolorizeConnectedComponents(const map<ColorType,ColorType>& LUT)
 {
-	ColorType* end = pixels + numberPixels;
-	for (ColorType* j = pixels; j < end; ++j)
-	{
-		try {
-			*j = LUT.at(*j);
-		}
-		catch (const out_of_range& oor) {
-		}
-	}
+	ColorLUT lut;
+	for (map<ColorType,ColorType>::const_iterator c = LUT.begin(); c != LUT.end(); ++c)
+		lut.set(c->first, c->second);
+	lut.apply(pixels, xAxes, yAxes);
 }
 
 void ColorMap::eraseColors(const set<ColorType>& colors)
 {
-	ColorType* end = pixels + numberPixels;
-	for (ColorType* j = pixels; j < end; ++j)
-	{
-		if (colors.count(*j)!=0)
-			*j = nullpixelvalue;
-	}
+	ColorLUT lut;
+	for (set<ColorType>::const_iterator c = colors.begin(); c != colors.end(); ++c)
+		lut.set(*c, nullpixelvalue);
+	lut.apply(pixels, xAxes, yAxes);
 }
 		
 
 void ColorMap::keepColors(const set<ColorType>& colors)
 {
-	ColorType* end = pixels + numberPixels;
-	for (ColorType* j = pixels; j < end; ++j)
-	{
-		if (colors.count(*j)==0)
-			*j = nullpixelvalue;
-	}
+	ColorLUT lut(nullpixelvalue);
+	for (set<ColorType>::const_iterator c = colors.begin(); c != colors.end(); ++c)
+		lut.set(*c, *c);
+	lut.apply(pixels, xAxes, yAxes);
 }
 
 unsigned ColorMap::propagateColor(const ColorType color, const PixLoc& firstPixel)
@@ -772,34 +1224,42 @@ unsigned ColorMap::propagateColor(const ColorType color, const unsigned firstPix
 
 unsigned ColorMap::thresholdConnectedComponents(const unsigned minSize, const ColorType setValue)
 {
-	deque<unsigned> treatedPixels;
-	ColorType color = setValue + 1;
-	for (unsigned j = 0; j < numberPixels; ++j)
+	ConnectedComponents components(pixels, xAxes, yAxes, setValue);
+	
+	// We make a lookup table of the components to remove
+	vector<char> small(components.NumberComponents() + 1, false);
+	unsigned numberComponents = 0;
+	for (unsigned c = 1; c <= components.NumberComponents(); ++c)
 	{
-		if(pixels[j] == setValue)
-		{
-			if (propagateColor(color, j) < minSize)
-				propagateColor(nullpixelvalue, j);
-			else
-			{
-				++color;
-				treatedPixels.push_back(j);
-			}
-		}
+		small[c] = components.Size(c) < minSize;
+		if(! small[c])
+			++numberComponents;
 	}
-	//We have to give back the original color
-	for (unsigned t = 0; t < treatedPixels.size(); ++t)
+	
+	for (unsigned j = 0; j < numberPixels; ++j)
 	{
-		propagateColor(setValue, treatedPixels[t]);
+		if(small[components.label(j)])
+			pixels[j] = nullpixelvalue;
 	}
 
-	return unsigned(color - 1 - setValue);
+	return numberComponents;
 }
 
 
 ColorMap* ColorMap::removeHoles(ColorType unusedColor)
 {
-	propagateColor(unusedColor, 0);
+	if(numberPixels == 0)
+		return this;
+	
+	// The background is the connected component of the first pixel
+	{
+		ConnectedComponents components(pixels, xAxes, yAxes, pixels[0]);
+		for (unsigned j = 0; j < numberPixels; ++j)
+		{
+			if(components.label(j) == 1)
+				pixels[j] = unusedColor;
+		}
+	}
 	ColorType lastColor = nullpixelvalue;
 	for (unsigned j = 0; j < numberPixels; ++j)
 	{
@@ -812,7 +1272,14 @@ ColorMap* ColorMap::removeHoles(ColorType unusedColor)
 			pixels[j] = lastColor;
 		}
 	}
-	propagateColor(nullpixelvalue, 0);
+	{
+		ConnectedComponents components(pixels, xAxes, yAxes, unusedColor);
+		for (unsigned j = 0; j < numberPixels; ++j)
+		{
+			if(components.label(j) == 1)
+				pixels[j] = nullpixelvalue;
+		}
+	}
 	return this;
 }
 
@@ -895,9 +1362,19 @@ void ColorMap::computeButterflyStats(vector<float>& totalNumberOfPixels, vector<
 	unsigned maxy = sun_center.y + sun_radius + 2;
 	unsigned minx = sun_center.x - sun_radius - 1;
 	unsigned maxx = sun_center.x + sun_radius + 2;
+	vector<Real> rowLongitude(maxx > minx ? maxx - minx : 0), rowLatitude(rowLongitude.size());
 	for (unsigned y = miny; y < maxy ; ++y)
 	{
-		for (unsigned x = minx; x < maxx; ++x)
+		// We convert at once the part of the row that is on the sun disc
+		Real dy = fabs(y - sun_center.y);
+		unsigned beginx = minx, endx = maxx;
+		while(beginx < endx && radius_squared - (fabs(beginx - sun_center.x) * fabs(beginx - sun_center.x)) - (dy * dy) <= 0)
+			++beginx;
+		while(endx > beginx && radius_squared - (fabs(endx - 1 - sun_center.x) * fabs(endx - 1 - sun_center.x)) - (dy * dy) <= 0)
+			--endx;
+		if(beginx < endx)
+			toHGS(y, beginx, endx, &(rowLongitude[0]), &(rowLatitude[0]));
+		for (unsigned x = beginx; x < endx; ++x)
 		{
 			// We compute sigma, the square distance of the pixel to the sun edge
 			Real dx = fabs(x - sun_center.x);
@@ -906,7 +1383,7 @@ void ColorMap::computeButterflyStats(vector<float>& totalNumberOfPixels, vector<
 			
 			if(sigma > 0)
 			{
-				HGS hgs = toHGS(RealPixLoc(x, y));
+				HGS hgs(rowLongitude[x - beginx], rowLatitude[x - beginx]);
 				if (!!hgs)
 				{
 					//cout<<"Latitude of coord "<<RealPixLoc(x, y)<< " : "<< int(hgs.latitude * RADIAN2DEGREE)<< "\n";
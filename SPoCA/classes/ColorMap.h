@@ -16,6 +16,19 @@
 
 class ColorMap : public SunImage<ColorType>
 {
+	protected :
+		//! Routine that set the rows [beginRow, endRow) of image to the colors of the ColorMap interpolated at the locations given by the remap table
+		void remapRows(const RemapTable* table, Image<ColorType>* image, const unsigned beginRow, const unsigned endRow) const;
+		
+		//! Routine to do dilation with the shape of a disc, by drawing the disc around each pixel of the contours
+		ColorMap* dilateCircularByStamping(const Real size, const ColorType unsetValue);
+		
+		//! Routine to do erosion with the shape of a disc, by drawing the disc around each pixel of the contours
+		ColorMap* erodeCircularByStamping(const Real size, const ColorType unsetValue);
+		
+		//! Routine to do dilation or erosion with the shape of a disc projected onto the sun
+		ColorMap* morphologyCircularProjected(const Real size, const ColorType unsetValue, const bool erosion);
+	
 	public :
 		//! Constructor
 		ColorMap(const unsigned& xAxes = 0, const unsigned& yAxes = 0);
@@ -44,6 +57,15 @@ class ColorMap : public SunImage<ColorType>
 		//! Routine to read the sun parameters from the header
 		void parseHeader();
 		
+		using SunImage<ColorType>::readFits;
+		
+		//! Routine to read from a fits file
+		/*! If the file has a color remap table (see writeColorRemap), the colors of the map are replaced by their new colors, and the map is marked as tracked */
+		FitsFile& readFits(FitsFile& file);
+		
+		//! Routine that replaces the colors of the map by their new colors, the other colors are not changed
+		void remapColors(const std::vector<ColorType>& colors, const std::vector<ColorType>& newColors);
+		
 		//! Routine to write the sun parameters to the header
 		void fillHeader();
 		
@@ -63,11 +85,18 @@ class ColorMap : public SunImage<ColorType>
 		ColorMap* erodeDiamond(const unsigned size, const ColorType pixelValueToErode);
 		
 		//! Routine to do dilation with the shape of a disc
+		/*! The disc is made of the pixels at a distance smaller or equal than size, it is computed with a distance transform (see distancetransform.h) */
 		ColorMap* dilateCircular(const Real size, const ColorType unsetValue);
 		
 		//! Routine to do erosion with the shape of a disc
+		/*! The disc is made of the pixels at a distance smaller or equal than size, it is computed with a distance transform (see distancetransform.h) */
 		ColorMap* erodeCircular(const Real size, const ColorType unsetValue);
 		
+		//! Routine to do a closing that also removes the small components
+		/*! It does an erosion of cleaningSize, a dilation of cleaningSize + aggregationSize and an erosion of aggregationSize, like erodeCircular and dilateCircular.
+		When the pixels that are set have all the same color, the 3 operations are done on a binary map and share the buffers of the distance transforms */
+		ColorMap* closeCircular(const Real cleaningSize, const Real aggregationSize, const ColorType unsetValue);
+		
 		//! Compute the hcc coordinates of the right half circle of radius size around the center of the sun
 		std::vector<HCC> get_half_circle(Real size);
 		
@@ -75,9 +104,11 @@ class ColorMap : public SunImage<ColorType>
 		std::vector<PixLoc> get_shape(PixLoc center, const std::vector<HCC>& line);
 		
 		//! Routine to do dilation with the shape of a disc projected onto the sun
+		/*! The shapes of get_shape are computed as spans of rows, in parallel for the rows of the contours */
 		ColorMap* dilateCircularProjected(const Real size, const ColorType unsetValue);
 		
-		//! Routine to do dilation with the shape of a disc projected onto the sun
+		//! Routine to do erosion with the shape of a disc projected onto the sun
+		/*! The shapes of get_shape are computed as spans of rows, in parallel for the rows of the contours */
 		ColorMap* erodeCircularProjected(const Real size, const ColorType unsetValue);
 		
 		//! Routine to threshold regions by its raw size
@@ -86,7 +117,8 @@ class ColorMap : public SunImage<ColorType>
 		//! Routine to threshold regions by its size at disc center
 		void thresholdRegionsByRealArea(double minSize);
 		
-		//! Routine that removes connected component of a size (number of pixels) smaller than minSize
+		//! Routine that removes connected component of pixels of value setValue of a size (number of pixels) smaller than minSize
+		/*! Returns the number of connected components left */
 		unsigned thresholdConnectedComponents(const unsigned minSize, const ColorType setValue = 0);
 		
 		//! Routine to propagate a color in the connected component specified by firstPixel
@@ -126,5 +158,41 @@ class ColorMap : public SunImage<ColorType>
 };
 
 bool isColorMap(const Header& header);
+
+//! Routine to read the color remap table of a fits file, returns false if the file has none
+/*! The current HDU of the file is not changed */
+bool readColorRemap(FitsFile& file, std::vector<ColorType>& colors, std::vector<ColorType>& newColors);
+
+//! Routine to write the color remap table of a fits file, so that the colors of its map are replaced by their new colors when it is read
+/*!
+The map of the file is not rewritten, only the small table "ColorRemap" with the columns COLOR and NEW_COLOR is.
+@param colors The colors of the map as read by ColorMap::readFits, i.e. after the remap table already in the file if any
+@param newColors The new color of each color
+If the file already has a table, the new colors are applied to its entries, and the colors that none of its entries gives are added to it.
+*/
+FitsFile& writeColorRemap(FitsFile& file, const std::vector<ColorType>& colors, const std::vector<ColorType>& newColors);
+
+//! Routine that returns the color that covers the most of the square between the pixel p, its right, upper and upper right neighbours
+inline ColorType majority(const ColorType* p, const unsigned xAxes, const float dx, const float dy)
+{
+	float cdx = 1. - dx;
+	float cdy = 1. - dy;
+	ColorType colors[] = {*p, *(p+1), *(p+xAxes), *(p+xAxes+1)};
+	float quantity[] = {cdx*cdy, dx*cdy, cdx*dy, dx*dy};
+	
+	for(unsigned i = 0; i < 3; ++i)
+		for(unsigned j = i+1; j < 4; ++j)
+			if(colors[i] == colors[j])
+			{
+				quantity[i] += quantity[j];
+				quantity[j] = 0;
+			}
+	unsigned max = 0;
+	for(unsigned i = 1; i < 4; ++i)
+		max = quantity[i] > quantity[max] ? i : max;
+	
+	return colors[max];
+}
+
 #endif
 
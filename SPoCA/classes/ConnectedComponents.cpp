@@ -0,0 +1,121 @@
+#include "ConnectedComponents.h"
+#include <limits>
+
+#include "parallel.h"
+
+//!@file ConnectedComponents.cpp
+
+using namespace std;
+
+//! Value of the label of the pixels that are not of the color, during the labelling
+static const unsigned NO_LABEL = numeric_limits<unsigned>::max();
+
+//! Functor to label the tiles of rows in parallel
+class ConnectedComponentsLabeller
+{
+	private :
+		ConnectedComponents* components;
+		const ColorType* pixels;
+		const ColorType color;
+	public :
+		ConnectedComponentsLabeller(ConnectedComponents* components, const ColorType* pixels, const ColorType color)
+		:components(components), pixels(pixels), color(color)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			components->labelRows(pixels, color, beginRow, endRow);
+		}
+};
+
+ConnectedComponents::ConnectedComponents(const ColorType* pixels, const unsigned xAxes, const unsigned yAxes, const ColorType color)
+:xAxes(xAxes), yAxes(yAxes), labels(xAxes * yAxes), sizes(1, 0), boxmin(1), boxmax(1)
+{
+	// During the labelling, the label of a pixel is the index of a pixel of its component that comes before it, or its own index for the first pixel
+	unsigned tileRows = yAxes / (8 * numberThreads());
+	if(tileRows == 0)
+		tileRows = 1;
+	ConnectedComponentsLabeller labeller(this, pixels, color);
+	parallel_for_rows(yAxes, labeller, tileRows);
+
+	// We merge the components across the borders of the tiles
+	for(unsigned y = tileRows; y < yAxes; y += tileRows)
+	{
+		const unsigned first = y * xAxes;
+		if(xAxes > 0 && pixels[first] == color && pixels[first - 1] == color)
+			merge(first, first - 1);
+		for(unsigned j = first; j < first + xAxes; ++j)
+			if(pixels[j] == color && pixels[j - xAxes] == color)
+				merge(j, j - xAxes);
+	}
+
+	// The pixels that come before have their final label, so each pixel takes the label of the pixel it points to
+	for(unsigned y = 0, j = 0; y < yAxes; ++y)
+	{
+		for(unsigned x = 0; x < xAxes; ++x, ++j)
+		{
+			unsigned& label = labels[j];
+			if(label == NO_LABEL)
+			{
+				label = 0;
+				continue;
+			}
+			if(label == j)
+			{
+				label = sizes.size();
+				sizes.push_back(0);
+				boxmin.push_back(PixLoc(x, y));
+				boxmax.push_back(PixLoc(x, y));
+			}
+			else
+			{
+				label = labels[label];
+			}
+			++sizes[label];
+			if(x < boxmin[label].x)
+				boxmin[label].x = x;
+			if(x > boxmax[label].x)
+				boxmax[label].x = x;
+			boxmax[label].y = y;
+		}
+	}
+}
+
+void ConnectedComponents::labelRows(const ColorType* pixels, const ColorType color, const unsigned beginRow, const unsigned endRow)
+{
+	const unsigned first = beginRow * xAxes;
+	const unsigned end = endRow * xAxes;
+	for(unsigned j = first; j < end; ++j)
+	{
+		if(pixels[j] != color)
+		{
+			labels[j] = NO_LABEL;
+			continue;
+		}
+		labels[j] = j;
+		if(j > first && pixels[j - 1] == color)
+			merge(j, j - 1);
+		if(j >= first + xAxes && pixels[j - xAxes] == color)
+			merge(j, j - xAxes);
+	}
+}
+
+unsigned ConnectedComponents::root(unsigned j)
+{
+	while(labels[j] != j)
+	{
+		labels[j] = labels[labels[j]];
+		j = labels[j];
+	}
+	return j;
+}
+
+void ConnectedComponents::merge(unsigned j, unsigned k)
+{
+	j = root(j);
+	k = root(k);
+	// The first pixel of the component stays the root
+	if(j < k)
+		labels[k] = j;
+	else if(k < j)
+		labels[j] = k;
+}
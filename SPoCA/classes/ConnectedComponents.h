@@ -0,0 +1,77 @@
+#pragma once
+#ifndef ConnectedComponents_H
+#define ConnectedComponents_H
+
+#include <vector>
+
+#include "constants.h"
+#include "Coordinate.h"
+
+//! Class that labels the connected components of the pixels of a given color of a map
+/*!
+Two pixels are connected if their index differ by 1 or by xAxes, like in ColorMap::propagateColor.
+The components are numbered from 1, in the order of their first pixel.
+
+The labelling is done with a union find in 2 passes: the rows are split in tiles that are labelled by different threads,
+the components that cross the borders of the tiles are then merged, and the labels are resolved in a last scan
+that also computes the number of pixels and the bounding box of each component.
+*/
+
+class ConnectedComponents
+{
+	private :
+		//! Size of the X axes of the map
+		unsigned xAxes;
+
+		//! Size of the Y axes of the map
+		unsigned yAxes;
+
+		//! For each pixel, the number of its component, or 0 if it is not of the color
+		std::vector<unsigned> labels;
+
+		//! For each component, the number of pixels
+		std::vector<unsigned> sizes;
+
+		//! For each component, the lower left corner of the bounding box
+		std::vector<PixLoc> boxmin;
+
+		//! For each component, the upper right corner of the bounding box
+		std::vector<PixLoc> boxmax;
+
+		//! Routine that labels the rows [beginRow, endRow), without looking at the pixels outside
+		void labelRows(const ColorType* pixels, const ColorType color, const unsigned beginRow, const unsigned endRow);
+
+		//! Routine that merges the components of the pixel j and of the pixel k
+		void merge(unsigned j, unsigned k);
+
+		//! Routine that returns the first pixel of the component of pixel j
+		unsigned root(unsigned j);
+
+		friend class ConnectedComponentsLabeller;
+
+	public :
+		//! Constructor, label the pixels of value color of the map of size xAxes x yAxes
+		ConnectedComponents(const ColorType* pixels, const unsigned xAxes, const unsigned yAxes, const ColorType color);
+
+		//! Accessor to retrieve the number of components
+		unsigned NumberComponents() const
+		{return sizes.size() - 1;}
+
+		//! Accessor to retrieve the number of the component of pixel j, or 0 if it is not of the color
+		unsigned label(const unsigned j) const
+		{return labels[j];}
+
+		//! Accessor to retrieve the number of pixels of component c
+		unsigned Size(const unsigned c) const
+		{return sizes[c];}
+
+		//! Accessor to retrieve the lower left corner of the bounding box of component c
+		const PixLoc& Boxmin(const unsigned c) const
+		{return boxmin[c];}
+
+		//! Accessor to retrieve the upper right corner of the bounding box of component c
+		const PixLoc& Boxmax(const unsigned c) const
+		{return boxmax[c];}
+};
+
+#endif
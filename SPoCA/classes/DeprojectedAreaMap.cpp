@@ -0,0 +1,120 @@
+#include "DeprojectedAreaMap.h"
+#include <cmath>
+#include <deque>
+#include <limits>
+
+//!@file DeprojectedAreaMap.cpp
+
+using namespace std;
+
+//! The maps of the cache, the most recently requested last
+static deque<DeprojectedAreaMap*> areaMapCache;
+
+//! Mutex protecting the cache
+static pthread_mutex_t areaMapCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+DeprojectedAreaMap::DeprojectedAreaMap(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& sunCenter, const Real sunRadius)
+:xAxes(xAxes), yAxes(yAxes), sunCenter(sunCenter), sunRadius(sunRadius), correctionFactors(yAxes), uncertainities(yAxes), references(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+DeprojectedAreaMap::~DeprojectedAreaMap()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+bool DeprojectedAreaMap::sameGeometry(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& sunCenter, const Real sunRadius) const
+{
+	return this->xAxes == xAxes && this->yAxes == yAxes && this->sunCenter.x == sunCenter.x && this->sunCenter.y == sunCenter.y && this->sunRadius == sunRadius;
+}
+
+void DeprojectedAreaMap::computeRow(const unsigned y)
+{
+	vector<Real>& factors = correctionFactors[y];
+	vector<Real>& uncertainity = uncertainities[y];
+	factors.resize(xAxes);
+	uncertainity.resize(xAxes);
+	
+	const Real radius_squared = sunRadius * sunRadius;
+	const Real pixelAreaMm2 = RawPixelArea();
+	const Real dy = fabs(y - sunCenter.y);
+	for(unsigned x = 0; x < xAxes; ++x)
+	{
+		const Real dx = fabs(x - sunCenter.x);
+		const Real sigma = radius_squared - (dx * dx) - (dy * dy);
+		factors[x] = sigma > 0 ? sunRadius/sqrt(sigma) : numeric_limits<Real>::infinity();
+		uncertainity[x] = (pixelAreaMm2 / sqrt(sigma*sigma*sigma)) * (dx + dy + (2 * (SUN_RADIUS_VARIATION / SUN_RADIUS) * sigma) + ((SUN_RADIUS_VARIATION_PIXELS / sunRadius) * (radius_squared + sigma)));
+	}
+}
+
+void DeprojectedAreaMap::row(const unsigned y, const Real*& rowCorrectionFactors, const Real*& rowUncertainities)
+{
+	pthread_mutex_lock(&mutex);
+	if(correctionFactors[y].empty() && xAxes > 0)
+		computeRow(y);
+	pthread_mutex_unlock(&mutex);
+	rowCorrectionFactors = xAxes > 0 ? &(correctionFactors[y][0]) : NULL;
+	rowUncertainities = xAxes > 0 ? &(uncertainities[y][0]) : NULL;
+}
+
+void DeprojectedAreaMap::evict(const unsigned maxUnused)
+{
+	unsigned unused = 0;
+	for(deque<DeprojectedAreaMap*>::iterator m = areaMapCache.begin(); m != areaMapCache.end(); ++m)
+		if((*m)->references == 0)
+			++unused;
+
+	for(deque<DeprojectedAreaMap*>::iterator m = areaMapCache.begin(); unused > maxUnused && m != areaMapCache.end();)
+	{
+		if((*m)->references == 0)
+		{
+			delete *m;
+			m = areaMapCache.erase(m);
+			--unused;
+		}
+		else
+		{
+			++m;
+		}
+	}
+}
+
+DeprojectedAreaMap* DeprojectedAreaMap::get(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& sunCenter, const Real sunRadius)
+{
+	pthread_mutex_lock(&areaMapCacheMutex);
+	DeprojectedAreaMap* areaMap = NULL;
+	for(deque<DeprojectedAreaMap*>::iterator m = areaMapCache.begin(); m != areaMapCache.end(); ++m)
+	{
+		if((*m)->sameGeometry(xAxes, yAxes, sunCenter, sunRadius))
+		{
+			areaMap = *m;
+			areaMapCache.erase(m);
+			break;
+		}
+	}
+	if(areaMap == NULL)
+		areaMap = new DeprojectedAreaMap(xAxes, yAxes, sunCenter, sunRadius);
+	areaMapCache.push_back(areaMap);
+	++areaMap->references;
+	evict(AREA_MAP_CACHE_SIZE);
+	pthread_mutex_unlock(&areaMapCacheMutex);
+	return areaMap;
+}
+
+void DeprojectedAreaMap::release(DeprojectedAreaMap* areaMap)
+{
+	if(areaMap == NULL)
+		return;
+	pthread_mutex_lock(&areaMapCacheMutex);
+	--areaMap->references;
+	evict(AREA_MAP_CACHE_SIZE);
+	pthread_mutex_unlock(&areaMapCacheMutex);
+}
+
+void DeprojectedAreaMap::clearCache()
+{
+	pthread_mutex_lock(&areaMapCacheMutex);
+	evict(0);
+	pthread_mutex_unlock(&areaMapCacheMutex);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef DeprojectedAreaMap_H
+#define DeprojectedAreaMap_H
+
+#include <vector>
+#include <pthread.h>
+
+#include "constants.h"
+#include "Coordinate.h"
+
+//! Class that gives for each pixel of an image of the sun the terms of its area on the solar sphere
+/*!
+The area of a pixel on the solar sphere (Mm²) is its raw area SUN_RADIUS² / sun_radius², multiplied by the correction factor sun_radius / sqrt(sigma),
+where sigma = sun_radius² - dx² - dy² and dx, dy are the distances of the pixel to the sun center.
+The correction factor is infinite for the pixels that are not on the disc, the users limit it to HIGGINS_FACTOR.
+
+Those terms only depend on the size of the image, the sun center and the sun radius, so the maps are kept in a cache (see get)
+and a series of images of the same geometry computes them once. The rows are computed the first time they are accessed,
+and can be accessed by several threads.
+The maps are obtained with DeprojectedAreaMap::get and must be given back with DeprojectedAreaMap::release,
+the cache keeps at most AREA_MAP_CACHE_SIZE unused maps (see @ref Compilation_Options).
+*/
+
+class DeprojectedAreaMap
+{
+	private :
+		//! Size of the X axes of the image
+		unsigned xAxes;
+
+		//! Size of the Y axes of the image
+		unsigned yAxes;
+
+		//! The sun center
+		RealPixLoc sunCenter;
+
+		//! The sun radius in pixels
+		Real sunRadius;
+
+		//! For each row, the correction factors of its pixels, empty until the row is computed
+		std::vector< std::vector<Real> > correctionFactors;
+
+		//! For each row, the uncertainities of the area of its pixels, empty until the row is computed
+		std::vector< std::vector<Real> > uncertainities;
+
+		//! Mutex protecting the computation of the rows
+		pthread_mutex_t mutex;
+
+		//! Number of users of the map
+		unsigned references;
+
+		//! Routine that computes the row y
+		void computeRow(const unsigned y);
+
+		//! Routine that deletes the least recently used unused maps of the cache, until there is at most maxUnused left
+		static void evict(const unsigned maxUnused);
+
+		//! The maps are not copied
+		DeprojectedAreaMap(const DeprojectedAreaMap&);
+		DeprojectedAreaMap& operator=(const DeprojectedAreaMap&);
+
+	public :
+		//! Constructor for an image of size xAxes x yAxes
+		DeprojectedAreaMap(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& sunCenter, const Real sunRadius);
+
+		//! Destructor
+		~DeprojectedAreaMap();
+
+		//! Test if the map is for an image of that geometry
+		bool sameGeometry(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& sunCenter, const Real sunRadius) const;
+
+		//! Accessor to retrieve the raw area of a pixel in Mm²
+		Real RawPixelArea() const
+		{return (SUN_RADIUS) * (SUN_RADIUS) / (sunRadius * sunRadius);}
+
+		//! Routine that gives the correction factors and the uncertainities of the area in Mm² of the pixels of row y
+		void row(const unsigned y, const Real*& rowCorrectionFactors, const Real*& rowUncertainities);
+
+		//! Routine that returns the map for an image of that geometry, from the cache or newly created
+		/*! The map must be given back with release when it is not used anymore */
+		static DeprojectedAreaMap* get(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& sunCenter, const Real sunRadius);
+
+		//! Routine to give back a map obtained with get
+		static void release(DeprojectedAreaMap* areaMap);
+
+		//! Routine to remove all unused maps from the cache
+		static void clearCache();
+};
+
+#endif
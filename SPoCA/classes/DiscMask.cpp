@@ -0,0 +1,36 @@
+#include "DiscMask.h"
+
+//!@file DiscMask.cpp
+
+using namespace std;
+
+DiscMask::DiscMask(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& center, const Real radius)
+:xAxes(xAxes), yAxes(yAxes), rowBegin(yAxes, 0), rowEnd(yAxes, 0), numberPixels(0)
+{
+	const Real radius2 = radius * radius;
+	for(unsigned y = 0; y < yAxes; ++y)
+	{
+		const Real dy2 = (Real(y) - center.y) * (Real(y) - center.y);
+		if(dy2 > radius2)
+			continue;
+
+		// We estimate the span, and correct it with the exact test for the pixels at the limit
+		const Real halfWidth = sqrt(radius2 - dy2);
+		Real begin = ceil(center.x - halfWidth);
+		Real end = floor(center.x + halfWidth) + 1;
+		unsigned xBegin = begin < 0 ? 0 : begin > xAxes ? xAxes : unsigned(begin);
+		unsigned xEnd = end < 0 ? 0 : end > xAxes ? xAxes : unsigned(end);
+		while(xBegin > 0 && (Real(xBegin - 1) - center.x) * (Real(xBegin - 1) - center.x) + dy2 <= radius2)
+			--xBegin;
+		while(xBegin < xEnd && (Real(xBegin) - center.x) * (Real(xBegin) - center.x) + dy2 > radius2)
+			++xBegin;
+		while(xEnd < xAxes && (Real(xEnd) - center.x) * (Real(xEnd) - center.x) + dy2 <= radius2)
+			++xEnd;
+		while(xEnd > xBegin && (Real(xEnd - 1) - center.x) * (Real(xEnd - 1) - center.x) + dy2 > radius2)
+			--xEnd;
+
+		rowBegin[y] = xBegin;
+		rowEnd[y] = xEnd;
+		numberPixels += xEnd - xBegin;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef DiscMask_H
+#define DiscMask_H
+
+#include <vector>
+
+#include "constants.h"
+#include "Coordinate.h"
+
+//! Class that gives, for each row of an image, the span of columns that are inside a disc
+/*!
+A pixel (x, y) is inside the disc if (x - center.x)² + (y - center.y)² <= radius².
+Because a disc is convex, the pixels of a row that are inside form a single span [RowBegin(y), RowEnd(y)).
+The mask is used to restrict the traversal of an image to the disc (see Enumerator2D).
+*/
+
+class DiscMask
+{
+	private :
+		//! Size of the X axes of the image
+		unsigned xAxes;
+
+		//! Size of the Y axes of the image
+		unsigned yAxes;
+
+		//! For each row, the first column inside the disc
+		std::vector<unsigned> rowBegin;
+
+		//! For each row, the last column + 1 inside the disc
+		std::vector<unsigned> rowEnd;
+
+		//! Number of pixels inside the disc
+		unsigned numberPixels;
+
+	public :
+		//! Constructor for an image of size xAxes x yAxes
+		DiscMask(const unsigned xAxes = 0, const unsigned yAxes = 0, const RealPixLoc& center = RealPixLoc(0, 0), const Real radius = 0);
+
+		//! Accessor to retrieve the size of the X axes of the image
+		unsigned Xaxes() const
+		{return xAxes;}
+
+		//! Accessor to retrieve the size of the Y axes of the image
+		unsigned Yaxes() const
+		{return yAxes;}
+
+		//! Accessor to retrieve the first column of row y inside the disc
+		unsigned RowBegin(const unsigned y) const
+		{return rowBegin[y];}
+
+		//! Accessor to retrieve the last column + 1 of row y inside the disc
+		unsigned RowEnd(const unsigned y) const
+		{return rowEnd[y];}
+
+		//! Accessor to retrieve the number of pixels inside the disc
+		unsigned NumberPixels() const
+		{return numberPixels;}
+
+		//! Test if the pixel (x, y) is inside the disc
+		bool contains(const unsigned x, const unsigned y) const
+		{return y < yAxes && rowBegin[y] <= x && x < rowEnd[y];}
+};
+
+#endif
@@ -0,0 +1,131 @@
+#pragma once
+#ifndef Enumerator_H
+#define Enumerator_H
+
+#include <iostream>
+#include <cstdlib>
+
+#include "constants.h"
+#include "Coordinate.h"
+#include "DiscMask.h"
+
+/*!
+@file Enumerator.h
+Iterators over the pixels of an Image, that also give the index or the coordinate of the pixel.
+
+They are used like this:
+@code
+for(Enumerator2D<const ColorType> p = map->enumerator2D(); p.valid(); ++p)
+	if(*p != map->null())
+		do_something(p.index(), p.coordinate(), *p);
+@endcode
+
+The pixel type is const for the enumerators of a const Image.
+*/
+
+//! Iterator over the pixels of an Image, that knows the index of the pixel
+template<class T>
+class Enumerator
+{
+	private :
+		T* pixels;
+		unsigned numberPixels;
+		unsigned j;
+
+	public :
+		//! Constructor for the array pixels of size numberPixels
+		Enumerator(T* pixels, const unsigned numberPixels)
+		:pixels(pixels), numberPixels(numberPixels), j(0)
+		{}
+
+		//! Test if the enumerator is not past the last pixel
+		bool valid() const
+		{return j < numberPixels;}
+
+		//! Go to the next pixel
+		Enumerator& operator++()
+		{
+			++j;
+			return *this;
+		}
+
+		//! Accessor to retrieve a reference to the pixel
+		T& operator*() const
+		{return pixels[j];}
+
+		//! Accessor to retrieve the index of the pixel
+		unsigned index() const
+		{return j;}
+};
+
+//! Iterator over the pixels of an Image, that knows the index and the coordinate of the pixel
+/*! If a DiscMask is given, only the pixels inside the disc are visited, row by row */
+template<class T>
+class Enumerator2D
+{
+	private :
+		T* pixels;
+		unsigned xAxes;
+		unsigned yAxes;
+		const DiscMask* mask;
+		unsigned j;
+		PixLoc c;
+		unsigned rowEnd;
+
+		//! Go to the first pixel of the first non empty row starting from y
+		void startRow(unsigned y)
+		{
+			for(; y < yAxes; ++y)
+			{
+				c.x = mask ? mask->RowBegin(y) : 0;
+				rowEnd = mask ? mask->RowEnd(y) : xAxes;
+				if(c.x < rowEnd)
+					break;
+			}
+			c.y = y;
+			j = y * xAxes + c.x;
+		}
+
+	public :
+		//! Constructor for the array pixels of size xAxes x yAxes
+		Enumerator2D(T* pixels, const unsigned xAxes, const unsigned yAxes, const DiscMask* mask = NULL)
+		:pixels(pixels), xAxes(xAxes), yAxes(yAxes), mask(mask), j(0), c(0, 0), rowEnd(0)
+		{
+			#if defined EXTRA_SAFE
+			if(mask && (mask->Xaxes() != xAxes || mask->Yaxes() != yAxes))
+			{
+				std::cerr<<"Error : The disc mask does not correspond to the size of the image."<<std::endl;
+				exit(EXIT_FAILURE);
+			}
+			#endif
+			startRow(0);
+		}
+
+		//! Test if the enumerator is not past the last pixel
+		bool valid() const
+		{return c.y < yAxes;}
+
+		//! Go to the next pixel
+		Enumerator2D& operator++()
+		{
+			++j;
+			++c.x;
+			if(c.x >= rowEnd)
+				startRow(c.y + 1);
+			return *this;
+		}
+
+		//! Accessor to retrieve a reference to the pixel
+		T& operator*() const
+		{return pixels[j];}
+
+		//! Accessor to retrieve the index of the pixel
+		unsigned index() const
+		{return j;}
+
+		//! Accessor to retrieve the coordinate of the pixel
+		const PixLoc& coordinate() const
+		{return c;}
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "FitsFile.h"
+#include "buffers.h"
 
 using namespace std;
 
@@ -115,8 +116,7 @@ FitsFile& FitsFile::moveTo(const string& extension_name)
 bool FitsFile::has(const string& extension_name)
 {
 	// We save the current_hdu
-	int current_hdu;
-	fits_get_hdu_num(fptr, &current_hdu);
+	int current_hdu = currentHDU();
 	// We check if we can move to the researched hdu
 	char* extname = const_cast<char *>(extension_name.c_str());
 	int temp_status = 0;
@@ -128,6 +128,24 @@ bool FitsFile::has(const string& extension_name)
 
 }
 
+FitsFile& FitsFile::remove(const string& extension_name)
+{
+	moveTo(extension_name);
+	if (fits_delete_hdu(fptr, NULL, &status) )
+	{
+		cerr<<"Error : deleting extension "<<extension_name<<" in file "<<filename<<" :"<< status <<endl;
+		fits_report_error(stderr, status);
+	}
+	return *this;
+}
+
+int FitsFile::currentHDU()
+{
+	int current_hdu;
+	fits_get_hdu_num(fptr, &current_hdu);
+	return current_hdu;
+}
+
 //Routine to determine the fits code for a C datatype
 int FitsFile::fitsDataType(const type_info& t)
 {
@@ -493,7 +511,7 @@ FitsFile& FitsFile::readImage(T*& image, unsigned &X, unsigned& Y, T* null)
 		exit(EXIT_FAILURE);
 	}
 	#endif
-	image = new T[numberPixels];
+	image = static_cast<T*>(allocateBuffer(numberPixels * sizeof(T)));
 	
 	// We read the pixels
 	int anynull;
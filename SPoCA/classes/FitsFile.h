@@ -80,6 +80,10 @@ class FitsFile
 		FitsFile& moveTo(const std::string& extension_name);
 		//! Routine to test if an HDU exist
 		bool has(const std::string& extension_name);
+		//! Routine to retrieve the number of the current HDU, to move back to it with moveTo
+		int currentHDU();
+		//! Routine to delete an HDU, the current HDU is then the next one
+		FitsFile& remove(const std::string& extension_name);
 		
 		//! Routine to read a Fits header
 		FitsFile& readHeader(Header& header);
@@ -88,6 +92,7 @@ class FitsFile
 		
 		//! Routine to read a 2D image
 		//! @tparam T Type of the pixels
+		/*! The memory for the pixels is allocated with allocateBuffer (see buffers.h) */
 		template<class T>
 		FitsFile& readImage(T*& image, unsigned &X, unsigned& Y, T* null = NULL);
 		//! Routine to write a 2D image
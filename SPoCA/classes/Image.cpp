@@ -3,25 +3,36 @@
 #include <assert.h>
 #include <algorithm>
 
+#include "RemapTable.h"
+#include "parallel.h"
+#include "buffers.h"
+
 //!@file Image.cpp
 
 using namespace std;
 
+//! Routine that computes the bilinear interpolation between the pixel p, its right, upper and upper right neighbours
+template<class T>
+static inline T bilinear(const T* p, const unsigned xAxes, const Real dx, const Real dy)
+{
+	Real cdx = 1. - dx;
+	Real cdy = 1. - dy;
+	return T(cdx*cdy*Real(*p) + dx*cdy*Real(*(p+1)) + cdx*dy*Real(*(p+xAxes)) + dx*dy*Real(*(p+xAxes+1)));
+}
+
 template<class T>
 Image<T>::Image(const unsigned& xAxes, const unsigned& yAxes)
 :xAxes(xAxes),yAxes(yAxes),numberPixels(xAxes * yAxes),pixels(NULL)
 {
 	nullpixelvalue = numeric_limits<T>::has_infinity?numeric_limits<T>::infinity():numeric_limits<T>::max();
-	if(numberPixels > 0)
-		pixels = new T[numberPixels];
-
+	pixels = allocatePixels(numberPixels);
 }
 
 template<class T>
 Image<T>::Image(const Image<T>& i)
 :xAxes(i.xAxes),yAxes(i.yAxes),numberPixels(i.numberPixels),nullpixelvalue(i.nullpixelvalue)
 {
-	pixels = new T[numberPixels];
+	pixels = allocatePixels(numberPixels);
 	memcpy(pixels, i.pixels, numberPixels * sizeof(T));
 }
 
@@ -30,15 +41,68 @@ template<class T>
 Image<T>::Image(const Image<T>* i)
 :xAxes(i->xAxes),yAxes(i->yAxes),numberPixels(i->numberPixels),nullpixelvalue(i->nullpixelvalue)
 {
-	pixels = new T[numberPixels];
+	pixels = allocatePixels(numberPixels);
 	memcpy(pixels, i->pixels, numberPixels * sizeof(T));
 }
 
+#if __cplusplus >= 201103L
+template<class T>
+Image<T>::Image(Image<T>&& i)
+:xAxes(0),yAxes(0),numberPixels(0),pixels(NULL),nullpixelvalue(i.nullpixelvalue)
+{
+	swapPixels(i);
+}
+
+template<class T>
+Image<T>& Image<T>::operator=(Image<T>&& i)
+{
+	if(&i != this)
+	{
+		swapPixels(i);
+		nullpixelvalue = i.nullpixelvalue;
+	}
+	return *this;
+}
+#endif
+
+template<class T>
+Image<T>& Image<T>::operator=(const Image<T>& i)
+{
+	if(&i != this)
+	{
+		resize(i.xAxes, i.yAxes);
+		memcpy(pixels, i.pixels, numberPixels * sizeof(T));
+		nullpixelvalue = i.nullpixelvalue;
+	}
+	return *this;
+}
+
+template<class T>
+void Image<T>::swapPixels(Image<T>& image)
+{
+	swap(xAxes, image.xAxes);
+	swap(yAxes, image.yAxes);
+	swap(numberPixels, image.numberPixels);
+	swap(pixels, image.pixels);
+}
+
+template<class T>
+T* Image<T>::allocatePixels(const unsigned numberPixels)
+{
+	return static_cast<T*>(allocateBuffer(numberPixels * sizeof(T)));
+}
+
+template<class T>
+void Image<T>::releasePixels(T* pixels, const unsigned numberPixels)
+{
+	releaseBuffer(pixels, numberPixels * sizeof(T));
+}
+
 
 template<class T>
 Image<T>::~Image()
 {
-	delete[] pixels;
+	releasePixels(pixels, numberPixels);
 	pixels = NULL;
 	#if defined VERBOSE
 		cerr<<"Destructor for Image called (pixels = "<<pixels<<" to "<< numberPixels * sizeof(T)<<")"<<endl;
@@ -119,9 +183,9 @@ Image<T>* Image<T>::resize(const unsigned xAxes, const unsigned yAxes)
 {
 	if(xAxes * yAxes != numberPixels)
 	{
+		releasePixels(pixels, numberPixels);
 		numberPixels = xAxes * yAxes;
-		delete[] pixels;
-		pixels = new T[numberPixels];
+		pixels = allocatePixels(numberPixels);
 	}
 	this->xAxes = xAxes;
 	this->yAxes = yAxes;
@@ -930,8 +994,9 @@ Image<T>* Image<T>::horizontal_convolution(const Image<T>* img,  const vector<fl
 	}
 	else
 	{
-		ptrout = new T[img->NumberPixels()];
+		ptrout = allocatePixels(img->NumberPixels());
 	}
+	T* const newPixels = ptrout;
 	
 
 	const unsigned radius = kernel.size() / 2;
@@ -970,8 +1035,8 @@ Image<T>* Image<T>::horizontal_convolution(const Image<T>* img,  const vector<fl
 	}
 	if(img == this)
 	{
-		delete[] pixels;
-		pixels = ptrout;
+		releasePixels(pixels, numberPixels);
+		pixels = newPixels;
 	}
 	return this;
 }
@@ -995,8 +1060,9 @@ Image<T>* Image<T>::vertical_convolution(const Image<T>* img, const vector<float
 	}
 	else
 	{
-		ptrout = new T[img->NumberPixels()];
+		ptrout = allocatePixels(img->NumberPixels());
 	}
+	T* const newPixels = ptrout;
 
 	const unsigned radius = kernel.size() / 2;
 
@@ -1045,8 +1111,8 @@ Image<T>* Image<T>::vertical_convolution(const Image<T>* img, const vector<float
 	}
 	if(img == this)
 	{
-		delete[] pixels;
-		pixels = ptrout;
+		releasePixels(pixels, numberPixels);
+		pixels = newPixels;
 	}
 	return this;
 }
@@ -1100,12 +1166,7 @@ inline T Image<T>::interpolate(float x, float y) const
 	
 	unsigned ix = (unsigned) x;
 	unsigned iy = (unsigned) y;
-	Real dx = x - ix;
-	Real dy = y - iy;
-	Real cdx = 1. - dx;
-	Real cdy = 1. - dy;
-	T* p = pixels + iy * xAxes + ix;
-	return T(cdx*cdy*Real(*p) + dx*cdy*Real(*(p+1)) + cdx*dy*Real(*(p+xAxes)) + dx*dy*Real(*(p+xAxes+1)));
+	return bilinear(pixels + iy * xAxes + ix, xAxes, x - ix, y - iy);
 }
 
 template<class T>
@@ -1124,6 +1185,9 @@ FitsFile& Image<T>::writeFits(FitsFile& file, int mode, const string imagename)
 template<class T>
 FitsFile& Image<T>::readFits(FitsFile& file)
 {
+	// The pixels are allocated by the FitsFile
+	releasePixels(pixels, numberPixels);
+	pixels = NULL;
 	file.readImage(pixels, xAxes, yAxes, &(nullpixelvalue));
 	numberPixels = xAxes * yAxes;
 	return file;
@@ -1153,7 +1217,7 @@ void Image<T>:: transform(const RealPixLoc transformationCenter, const Real rota
 	if (image == NULL or image == this)
 	{
 		image = this;
-		newPixels = new T[numberPixels];
+		newPixels = allocatePixels(numberPixels);
 	}
 	else
 	{
@@ -1198,13 +1262,66 @@ void Image<T>:: transform(const RealPixLoc transformationCenter, const Real rota
 	// We delete the memory allocated for the new pixels
 	if(image == this)
 	{
-		delete[] pixels;
+		releasePixels(pixels, numberPixels);
 		pixels = newPixels;
 	}
 }
 
 
 
+template<class T>
+void Image<T>::remapRows(const RemapTable* table, Image<T>* image, const unsigned beginRow, const unsigned endRow) const
+{
+	for(unsigned y = beginRow; y < endRow; ++y)
+	{
+		T* row = image->pixels + y * image->xAxes;
+		const unsigned rowBegin = table->RowBegin(y);
+		const unsigned rowEnd = table->RowEnd(y);
+		fill(row, row + rowBegin, image->nullpixelvalue);
+		for(unsigned x = rowBegin, j = y * image->xAxes + rowBegin; x < rowEnd; ++x, ++j)
+		{
+			const unsigned index = table->sourceIndex(j);
+			if(index == RemapTable::NO_SOURCE)
+				row[x] = image->nullpixelvalue;
+			else
+				row[x] = bilinear(pixels + index, xAxes, table->xWeight(j), table->yWeight(j));
+		}
+		fill(row + rowEnd, row + image->xAxes, image->nullpixelvalue);
+	}
+}
+
+//! Functor to remap the rows of an image in parallel
+template<class T>
+class ImageRemapper
+{
+	private :
+		const Image<T>* source;
+		const RemapTable* table;
+		Image<T>* destination;
+	public :
+		ImageRemapper(const Image<T>* source, const RemapTable* table, Image<T>* destination)
+		:source(source), table(table), destination(destination)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			source->remapRows(table, destination, beginRow, endRow);
+		}
+};
+
+template<class T>
+void Image<T>::remap(const RemapTable* table, Image<T>* image) const
+{
+	#if defined EXTRA_SAFE
+	if(table->SourceXaxes() != xAxes || table->SourceYaxes() != yAxes || table->Xaxes() != image->xAxes || table->Yaxes() != image->yAxes)
+	{
+		cerr<<"Error : The remap table does not correspond to the size of the images."<<endl;
+		exit(EXIT_FAILURE);
+	}
+	#endif
+	ImageRemapper<T> remapper(this, table, image);
+	parallel_for_rows(image->yAxes, remapper);
+}
+
 /*! @file Image.cpp
 Instantiation of the template class Image for EUVPixelType
 See @ref Compilation_Options constants.h */
@@ -14,6 +14,10 @@
 #include "constants.h"
 #include "Coordinate.h"
 #include "FitsFile.h"
+#include "Enumerator.h"
+
+class RemapTable;
+template<class T> class ImageRemapper;
 
 //! Class image and base class of all other image classes
 /*!
@@ -52,6 +56,17 @@ class Image
 		//! Computes the percentil value of the array arr
 		T quickselect(std::vector<T>& arr, Real percentil = 0.5) const;
 
+		//! Routine that allocates the memory for numberPixels pixels (see buffers.h)
+		static T* allocatePixels(const unsigned numberPixels);
+		
+		//! Routine to give back the memory of numberPixels pixels allocated with allocatePixels
+		static void releasePixels(T* pixels, const unsigned numberPixels);
+
+		//! Routine that set the rows [beginRow, endRow) of image to the values of the Image interpolated at the locations given by the remap table
+		virtual void remapRows(const RemapTable* table, Image<T>* image, const unsigned beginRow, const unsigned endRow) const;
+		
+		friend class ImageRemapper<T>;
+		
 	public :
 		//! Constructor for an Image of size xAxes x yAxes
 		Image(const unsigned& xAxes = 0, const unsigned& yAxes = 0);
@@ -64,9 +79,27 @@ class Image
 		/*! Allocate memory for the pixels and copy them*/
 		Image(const Image<T>* i);
 		
+		#if __cplusplus >= 201103L
+		//! Move Constructor
+		/*! Take the pixels of i, that is left empty */
+		Image(Image<T>&& i);
+		
+		//! Move assignment
+		/*! Exchange the pixels with the ones of i */
+		Image<T>& operator=(Image<T>&& i);
+		#endif
+		
+		//! Assignment
+		/*! Resize the Image and copy the pixels of i */
+		Image<T>& operator=(const Image<T>& i);
+		
 		//! Destructors
 		/*! Deallocate the reserved memory for the pixels*/
 		virtual ~Image();
+		
+		//! Routine to exchange the pixels and the size with those of image
+		/*! It allows to move pixels from one Image to another without copying them */
+		void swapPixels(Image<T>& image);
 
 		//! Accessor to retrieve the Xaxes
 		unsigned Xaxes() const;
@@ -95,6 +128,30 @@ class Image
 		//! Accessor to retrieve a const reference to a pixel
 		const T& pixel(const PixLoc& c)const;
 		
+		//! Accessor to retrieve a pointer to the first pixel of row y
+		T* row(const unsigned y)
+		{return pixels + y * xAxes;}
+		
+		//! Accessor to retrieve a const pointer to the first pixel of row y
+		const T* row(const unsigned y) const
+		{return pixels + y * xAxes;}
+		
+		//! Accessor to retrieve an enumerator over the pixels (see Enumerator.h)
+		Enumerator<T> enumerator()
+		{return Enumerator<T>(pixels, numberPixels);}
+		
+		//! Accessor to retrieve a const enumerator over the pixels (see Enumerator.h)
+		Enumerator<const T> enumerator() const
+		{return Enumerator<const T>(pixels, numberPixels);}
+		
+		//! Accessor to retrieve an enumerator over the pixels with their coordinate, restricted to the mask if given (see Enumerator.h)
+		Enumerator2D<T> enumerator2D(const DiscMask* mask = NULL)
+		{return Enumerator2D<T>(pixels, xAxes, yAxes, mask);}
+		
+		//! Accessor to retrieve a const enumerator over the pixels with their coordinate, restricted to the mask if given (see Enumerator.h)
+		Enumerator2D<const T> enumerator2D(const DiscMask* mask = NULL) const
+		{return Enumerator2D<const T>(pixels, xAxes, yAxes, mask);}
+		
 		//! Accessor to retrieve the interpolated value of the image in x, y
 		virtual T interpolate(float x, float y) const;
 		
@@ -243,6 +300,12 @@ class Image
 		*/
 		void transform(const RealPixLoc transformationCenter, const Real rotationAngle = 0., const RealPixLoc translation = RealPixLoc(0, 0), const Real scaling = 1, const Image<T> * image = NULL);
 		
+		//! Routine that set the pixels of image to the values of the Image interpolated at the locations given by the remap table
+		/*!	@param table A remap table whose source has the size of the Image, and destination the size of image (see RemapTable.h)
+			@param image The image to fill, pixels that have no source are set to its null value. It must not be the Image itself.
+		*/
+		void remap(const RemapTable* table, Image<T>* image) const;
+		
 
 };
 
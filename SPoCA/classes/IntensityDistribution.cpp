@@ -0,0 +1,120 @@
+#include "IntensityDistribution.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//!@file IntensityDistribution.cpp
+
+using namespace std;
+
+IntensityDistribution::IntensityDistribution()
+:numberValues(0), mean(0), m2(0), m3(0), m4(0)
+#if defined(ESTIMATE_QUANTILES)
+, firstPositiveBin(0), firstNegativeBin(0), numberNegatives(0), numberZeros(0)
+#endif
+{}
+
+void IntensityDistribution::add(const EUVPixelType intensity)
+{
+	// We update the moments with the deviation of the intensity to the previous mean
+	const Real n1 = numberValues;
+	++numberValues;
+	const Real n = numberValues;
+	const Real delta = intensity - mean;
+	const Real delta_n = delta / n;
+	const Real delta_n2 = delta_n * delta_n;
+	const Real term1 = delta * delta_n * n1;
+	mean += delta_n;
+	m4 += term1 * delta_n2 * (n * n - 3 * n + 3) + 6 * delta_n2 * m2 - 4 * delta_n * m3;
+	m3 += term1 * delta_n * (n - 2) - 3 * delta_n * m2;
+	m2 += term1;
+	
+	#if defined(ESTIMATE_QUANTILES)
+	if(intensity >= numeric_limits<EUVPixelType>::min())
+		addToBins(positiveBins, firstPositiveBin, intensity);
+	else if(intensity <= -numeric_limits<EUVPixelType>::min())
+	{
+		addToBins(negativeBins, firstNegativeBin, -intensity);
+		++numberNegatives;
+	}
+	else
+		++numberZeros;
+	#else
+	values.push_back(intensity);
+	#endif
+}
+
+#if defined(ESTIMATE_QUANTILES)
+
+//! Ratio between the upper and the lower limit of a bin
+static const Real binGamma = (1. + QUANTILE_RELATIVE_ACCURACY) / (1. - QUANTILE_RELATIVE_ACCURACY);
+
+//! Logarithm of binGamma
+static const Real logBinGamma = log(binGamma);
+
+void IntensityDistribution::addToBins(vector<unsigned>& bins, int& firstBin, const Real magnitude)
+{
+	// The bin i contains the magnitudes in (gamma^(i-1), gamma^i]
+	const int bin = int(ceil(log(magnitude) / logBinGamma));
+	if(bins.empty())
+	{
+		bins.push_back(0);
+		firstBin = bin;
+	}
+	else if(bin < firstBin)
+	{
+		bins.insert(bins.begin(), firstBin - bin, 0);
+		firstBin = bin;
+	}
+	else if(bin >= firstBin + int(bins.size()))
+	{
+		bins.resize(bin - firstBin + 1, 0);
+	}
+	++bins[bin - firstBin];
+}
+
+Real IntensityDistribution::binsQuantile(const vector<unsigned>& bins, const int firstBin, unsigned k, const bool fromLowest)
+{
+	for(unsigned i = 0; i < bins.size(); ++i)
+	{
+		const unsigned b = fromLowest ? i : bins.size() - 1 - i;
+		if(k < bins[b])
+		{
+			// The value in the middle of the bin, relatively, is at most QUANTILE_RELATIVE_ACCURACY from any value of the bin
+			return 2 * pow(binGamma, firstBin + int(b)) / (binGamma + 1);
+		}
+		k -= bins[b];
+	}
+	return NAN;
+}
+
+EUVPixelType IntensityDistribution::quantile(const Real percentil) const
+{
+	if(numberValues == 0)
+		return NAN;
+	
+	unsigned k = unsigned((numberValues - 1) * percentil);
+	
+	// The intensities are ordered from the most negative to the most positive
+	if(k < numberNegatives)
+		return - binsQuantile(negativeBins, firstNegativeBin, k, false);
+	k -= numberNegatives;
+	if(k < numberZeros)
+		return 0;
+	k -= numberZeros;
+	return binsQuantile(positiveBins, firstPositiveBin, k, true);
+}
+
+#else
+
+EUVPixelType IntensityDistribution::quantile(const Real percentil) const
+{
+	if(numberValues == 0)
+		return NAN;
+	
+	vector<EUVPixelType>::iterator kth = values.begin() + unsigned((numberValues - 1) * percentil);
+	nth_element(values.begin(), kth, values.end());
+	return *kth;
+}
+
+#endif
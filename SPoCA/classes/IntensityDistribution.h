@@ -0,0 +1,78 @@
+#pragma once
+#ifndef IntensityDistribution_H
+#define IntensityDistribution_H
+
+#include <vector>
+
+#include "constants.h"
+
+//! Class that accumulates the intensities of a set of pixels to compute their moments and quantiles
+/*!
+The central moments of order 2, 3 and 4 are updated with each intensity (Pébay's one pass formulas),
+so the intensities need not be kept to compute the variance, the skewness and the kurtosis.
+
+By default the intensities are kept in a contiguous buffer, and the quantiles are exact.
+If ESTIMATE_QUANTILES is defined, the intensities are counted in bins of logarithmic width instead,
+and the quantiles are estimated with a relative error of at most QUANTILE_RELATIVE_ACCURACY.
+The memory is then bounded by the range of the intensities, not by their number.
+*/
+
+class IntensityDistribution
+{
+	private :
+		//! Number of intensities
+		unsigned numberValues;
+		
+		//! Mean of the intensities, and sums of the powers 2, 3 and 4 of their deviations to the mean
+		Real mean, m2, m3, m4;
+		
+		#if defined(ESTIMATE_QUANTILES)
+		//! Number of intensities in each bin, for the positive and the negative intensities
+		std::vector<unsigned> positiveBins, negativeBins;
+		
+		//! Index of the first bin of positiveBins and negativeBins
+		int firstPositiveBin, firstNegativeBin;
+		
+		//! Number of negative intensities, and of intensities too close to 0 to be binned
+		unsigned numberNegatives, numberZeros;
+		
+		//! Routine to count an intensity of absolute value magnitude in bins
+		static void addToBins(std::vector<unsigned>& bins, int& firstBin, const Real magnitude);
+		
+		//! Routine that returns the absolute value of the intensity of rank k in bins, counted from the lowest bin or from the highest one
+		static Real binsQuantile(const std::vector<unsigned>& bins, const int firstBin, unsigned k, const bool fromLowest);
+		#else
+		//! The intensities
+		mutable std::vector<EUVPixelType> values;
+		#endif
+	
+	public :
+		//! Constructor
+		IntensityDistribution();
+		
+		//! Routine to add an intensity
+		/*! The intensity must be a number */
+		void add(const EUVPixelType intensity);
+		
+		//! Accessor to retrieve the number of intensities
+		unsigned size() const
+		{return numberValues;}
+		
+		//! Sum of the squares of the deviations to the mean
+		Real M2() const
+		{return m2;}
+		
+		//! Sum of the cubes of the deviations to the mean
+		Real M3() const
+		{return m3;}
+		
+		//! Sum of the 4th powers of the deviations to the mean
+		Real M4() const
+		{return m4;}
+		
+		//! Routine that returns the requested percentil of the intensities
+		/*! It is the intensity of rank (size - 1) * percentil, like quickselect, or an estimate of it if ESTIMATE_QUANTILES is defined */
+		EUVPixelType quantile(const Real percentil) const;
+};
+
+#endif
@@ -1,5 +1,10 @@
 #include "Region.h"
 #include <map>
+#include <algorithm>
+
+#include "ColorLUT.h"
+#include "DeprojectedAreaMap.h"
+#include "parallel.h"
 
 using namespace std;
 
@@ -154,7 +159,59 @@ string Region::toString(const string& separator, bool header) const
 	}
 }
 
+void Region::addSpan(const unsigned y, const unsigned xBegin, const unsigned xEnd)
+{
+	if(! spans.empty() && spans.back().y == y && spans.back().xEnd == xBegin)
+		spans.back().xEnd = xEnd;
+	else
+		spans.push_back(RegionSpan(y, xBegin, xEnd));
+}
+
+const vector<RegionSpan>& Region::Spans() const
+{
+	return spans;
+}
+
+bool Region::hasSpans() const
+{
+	return ! spans.empty();
+}
+
+void Region::deprojectedPixelArea(const PixLoc& coordinate, const RealPixLoc& sunCenter, const Real& sun_radius, Real& area, Real& uncertainity)
+{
+	// Compute the area error
+	const Real dx = fabs(coordinate.x - sunCenter.x);
+	const Real dy = fabs(coordinate.y - sunCenter.y);
+	const Real radius_squared = sun_radius * sun_radius;
+	const Real sigma = radius_squared - (dx * dx) - (dy * dy);
+	const Real pixelAreaMm2 = (SUN_RADIUS * SUN_RADIUS) / radius_squared;
+	Real areaCorrectionFactor = HIGGINS_FACTOR;
+	
+	if(sigma > 0)
+		areaCorrectionFactor = sun_radius/sqrt(sigma);
+	
+	// Limit the correction factor to some max limit in case the pixel is near the limb
+	if (areaCorrectionFactor > HIGGINS_FACTOR)
+		areaCorrectionFactor = HIGGINS_FACTOR;
+	
+	area = pixelAreaMm2 * areaCorrectionFactor;
+	uncertainity = (pixelAreaMm2 / sqrt(sigma*sigma*sigma)) * (dx + dy + (2 * (SUN_RADIUS_VARIATION / SUN_RADIUS) * sigma) + ((SUN_RADIUS_VARIATION_PIXELS / sun_radius) * (radius_squared + sigma)));
+}
+
 inline void Region::add(const PixLoc& coordinate, const bool& atBorder, const RealPixLoc& sunCenter, const Real& sun_radius, const Real pixelLength, const Real pixelWidth)
+{
+	// We compute the contribution of the pixel to the area as seen by the observer (arcsec²)
+	const Real pixelAreaArcsec2 = pixelLength * pixelWidth;
+	const Real pixelAreaArcsec2Uncertainity = 2 * pixelAreaArcsec2 * ((SUN_RADIUS_VARIATION / SUN_RADIUS) + (SUN_RADIUS_VARIATION_PIXELS / sun_radius));
+	
+	// We compute the contribution of the pixel to the area on the solar sphere (Mm²)
+	Real pixelAreaMm2, pixelAreaMm2Uncertainity;
+	deprojectedPixelArea(coordinate, sunCenter, sun_radius, pixelAreaMm2, pixelAreaMm2Uncertainity);
+	
+	add(coordinate, atBorder, sunCenter, pixelAreaArcsec2, pixelAreaArcsec2Uncertainity, pixelAreaMm2, pixelAreaMm2Uncertainity);
+}
+
+inline void Region::add(const PixLoc& coordinate, const bool& atBorder, const RealPixLoc& sunCenter, const Real pixelAreaArcsec2, const Real pixelAreaArcsec2Uncertainity, const Real pixelAreaMm2, const Real pixelAreaMm2Uncertainity)
 {
 	
 	// We compute the positions of the first pixel, and the bounding box
@@ -195,63 +252,135 @@ inline void Region::add(const PixLoc& coordinate, const bool& atBorder, const Re
 	centerxError = fabs(center.x/numberPixels - sunCenter.x);
 	centeryError = fabs(center.y/numberPixels - sunCenter.y);
 	
-	// We compute the contribution of the pixel to the area as seen by the observer (arcsec²)
-	const Real pixelAreaArcsec2 = pixelLength * pixelWidth;
+	// We add the contribution of the pixel to the area as seen by the observer (arcsec²)
 	areaProjected += pixelAreaArcsec2;
-	areaProjectedUncertainity += 2 * pixelAreaArcsec2 * ((SUN_RADIUS_VARIATION / SUN_RADIUS) + (SUN_RADIUS_VARIATION_PIXELS / sun_radius));
+	areaProjectedUncertainity += pixelAreaArcsec2Uncertainity;
 	if(atBorder)
 		areaProjectedUncertainity += pixelAreaArcsec2;
 	
-	// We compute the contribution of the pixel to the area on the solar sphere (Mm²)
-	// Compute the area error
-	const Real dx = fabs(coordinate.x - sunCenter.x);
-	const Real dy = fabs(coordinate.y - sunCenter.y);
-	const Real radius_squared = sun_radius * sun_radius;
-	const Real sigma = radius_squared - (dx * dx) - (dy * dy);
-	const Real pixelAreaMm2 = (SUN_RADIUS * SUN_RADIUS) / radius_squared;
-	Real areaCorrectionFactor = HIGGINS_FACTOR;
-	
-	if(sigma > 0)
-		areaCorrectionFactor = sun_radius/sqrt(sigma);
-	
-	// Limit the correction factor to some max limit in case the pixel is near the limb
-	if (areaCorrectionFactor > HIGGINS_FACTOR)
-		areaCorrectionFactor = HIGGINS_FACTOR;
-	
-	areaDeprojected += pixelAreaMm2 * areaCorrectionFactor;
-	areaDeprojectedUncertainity += (pixelAreaMm2 / sqrt(sigma*sigma*sigma)) * (dx + dy + (2 * (SUN_RADIUS_VARIATION / SUN_RADIUS) * sigma) + ((SUN_RADIUS_VARIATION_PIXELS / sun_radius) * (radius_squared + sigma)));
+	// We add the contribution of the pixel to the area on the solar sphere (Mm²)
+	areaDeprojected += pixelAreaMm2;
+	areaDeprojectedUncertainity += pixelAreaMm2Uncertainity;
 	if(atBorder)
-		areaDeprojectedUncertainity += pixelAreaMm2 * areaCorrectionFactor;
+		areaDeprojectedUncertainity += pixelAreaMm2;
 }
 
-vector<Region*> getRegions(const ColorMap* coloredMap)
+//! Pixel of a region found by the RegionPixelsScanner, with its contribution to the area on the solar sphere
+struct RegionPixel
 {
-	unsigned id = 0;
-	map<ColorType, Region*> regions;
+	unsigned x;
+	ColorType color;
+	bool atBorder;
+	Real area;
+	Real uncertainity;
+};
+
+//! Functor that finds the pixels of the regions in the rows [beginRow, endRow) of a map, with their border flag and their contribution to the area
+class RegionPixelsScanner
+{
+	private :
+		const ColorMap* map;
+		DeprojectedAreaMap* areaMap;
+		const unsigned firstRow;
+		vector< vector<RegionPixel> >& pixels;
+	public :
+		RegionPixelsScanner(const ColorMap* map, DeprojectedAreaMap* areaMap, const unsigned firstRow, vector< vector<RegionPixel> >& pixels)
+		:map(map), areaMap(areaMap), firstRow(firstRow), pixels(pixels)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			const unsigned xAxes = map->Xaxes();
+			const unsigned yAxes = map->Yaxes();
+			const ColorType null = map->null();
+			const Real pixelAreaMm2 = areaMap->RawPixelArea();
+			RegionPixel pixel;
+			for (unsigned r = beginRow; r < endRow; ++r)
+			{
+				const unsigned y = firstRow + r;
+				vector<RegionPixel>& rowPixels = pixels[r];
+				rowPixels.clear();
+				const ColorType* row = map->row(y);
+				// The pixels outside of the map are considered of a different color
+				const ColorType* previous = y > 0 ? row - xAxes : NULL;
+				const ColorType* next = y + 1 < yAxes ? row + xAxes : NULL;
+				const Real* correctionFactors = NULL;
+				const Real* uncertainities = NULL;
+				for (unsigned x = 0; x < xAxes; ++x)
+				{
+					const ColorType color = row[x];
+					if(color == null)
+						continue;
+					pixel.x = x;
+					pixel.color = color;
+					// Is the pixel in the contour (<=> there is a neighboor pixel != pixel color)
+					pixel.atBorder = x == 0 || row[x-1] != color || x + 1 == xAxes || row[x+1] != color || ! previous || previous[x] != color || ! next || next[x] != color;
+					// The area of the pixels is only needed for the rows with regions
+					if(! correctionFactors)
+						areaMap->row(y, correctionFactors, uncertainities);
+					// The correction factor is limited in case the pixel is near the limb
+					pixel.area = pixelAreaMm2 * (correctionFactors[x] > HIGGINS_FACTOR ? HIGGINS_FACTOR : correctionFactors[x]);
+					pixel.uncertainity = uncertainities[x];
+					rowPixels.push_back(pixel);
+				}
+			}
+		}
+};
+
+//! Comparison of the color of 2 regions
+static bool colorLess(const Region* a, const Region* b)
+{
+	return a->Color() < b->Color();
+}
+
+vector<Region*> getRegions(const ColorMap* coloredMap, const bool keepSpans)
+{
+	vector<Region*> regions;
+	// For each color, the number of its region + 1
+	ColorLUT regionIndex(0);
 	
-	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
-	{
-		for (unsigned x = 0; x < coloredMap->Xaxes(); ++x)
+	const RealPixLoc sunCenter = coloredMap->SunCenter();
+	const Real pixelAreaArcsec2 = coloredMap->PixelLength() * coloredMap->PixelWidth();
+	const Real pixelAreaArcsec2Uncertainity = 2 * pixelAreaArcsec2 * ((SUN_RADIUS_VARIATION / SUN_RADIUS) + (SUN_RADIUS_VARIATION_PIXELS / coloredMap->SunRadius()));
+	
+	// The area of the pixels on the solar sphere is computed once for all the maps of that geometry
+	DeprojectedAreaMap* areaMap = DeprojectedAreaMap::get(coloredMap->Xaxes(), coloredMap->Yaxes(), sunCenter, coloredMap->SunRadius());
+	
+	// The rows are scanned by blocks, to bound the memory of the pixels found
+	const unsigned blockRows = 64 * numberThreads();
+	vector< vector<RegionPixel> > pixels(blockRows);
+	for (unsigned firstRow = 0; firstRow < coloredMap->Yaxes(); firstRow += blockRows)
+	{
+		const unsigned numberRows = min(blockRows, coloredMap->Yaxes() - firstRow);
+		RegionPixelsScanner scanner(coloredMap, areaMap, firstRow, pixels);
+		parallel_for_rows(numberRows, scanner);
+		
+		for (unsigned r = 0; r < numberRows; ++r)
 		{
-			if(coloredMap->pixel(x,y) != coloredMap->null())
+			const unsigned y = firstRow + r;
+			for (vector<RegionPixel>::const_iterator p = pixels[r].begin(); p != pixels[r].end(); ++p)
 			{
-				const ColorType& color = coloredMap->pixel(x,y);
+				ColorType index = regionIndex(p->color);
 				// If no region of that color exist we create it
-				if(regions.count(color) == 0)
+				if(index == 0)
 				{
-					regions[color] = new Region(coloredMap->ObservationTime(), id, color);
-					++id;
+					regions.push_back(new Region(coloredMap->ObservationTime(), regions.size(), p->color));
+					index = regions.size();
+					regionIndex.set(p->color, index);
 				}
 				
-				// Is the pixel in the contour (<=> there is a neighboor pixel != pixel color)
-				bool atBorder = coloredMap->pixel(x-1,y) != color || coloredMap->pixel(x+1,y) != color || coloredMap->pixel(x,y-1) != color || coloredMap->pixel(x,y+1) != color;
-				
 				// We add the pixel to the region
-				regions[color]->add(PixLoc(x,y), atBorder, coloredMap->SunCenter(), coloredMap->SunRadius(), coloredMap->PixelLength(), coloredMap->PixelWidth());
+				regions[index - 1]->add(PixLoc(p->x,y), p->atBorder, sunCenter, pixelAreaArcsec2, pixelAreaArcsec2Uncertainity, p->area, p->uncertainity);
+				if(keepSpans)
+					regions[index - 1]->addSpan(y, p->x, p->x + 1);
 			}
 		}
 	}
-	return values(regions);
+	
+	DeprojectedAreaMap::release(areaMap);
+	
+	// The regions are returned by order of color
+	sort(regions.begin(), regions.end(), colorLess);
+	return regions;
 }
 
 vector<Region*> getRegions(const ColorMap* coloredMap, const set<ColorType>& colors)
@@ -287,6 +416,48 @@ vector<Region*> getRegions(const ColorMap* coloredMap, const set<ColorType>& col
 	return values(regions);
 }
 
+vector<Region*> getRegions(const RunLengthColorMap* coloredMap, const bool keepSpans)
+{
+	unsigned id = 0;
+	map<ColorType, Region*> regions;
+	const WCS& wcs = coloredMap->getWCS();
+	vector<bool> atBorder;
+	
+	const Real pixelAreaArcsec2 = wcs.cdelt1 * wcs.cdelt2;
+	const Real pixelAreaArcsec2Uncertainity = 2 * pixelAreaArcsec2 * ((SUN_RADIUS_VARIATION / SUN_RADIUS) + (SUN_RADIUS_VARIATION_PIXELS / wcs.sun_radius));
+	DeprojectedAreaMap* areaMap = DeprojectedAreaMap::get(coloredMap->Xaxes(), coloredMap->Yaxes(), wcs.sun_center, wcs.sun_radius);
+	const Real pixelAreaMm2 = areaMap->RawPixelArea();
+	const Real* correctionFactors;
+	const Real* uncertainities;
+	
+	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
+	{
+		if(coloredMap->rowBegin(y) < coloredMap->rowEnd(y))
+			areaMap->row(y, correctionFactors, uncertainities);
+		for (const ColorRun* r = coloredMap->rowBegin(y); r < coloredMap->rowEnd(y); ++r)
+		{
+			// If no region of that color exist we create it
+			Region*& region = regions[r->color];
+			if(region == NULL)
+			{
+				region = new Region(wcs.time_obs, id, r->color);
+				++id;
+			}
+			
+			// Is the pixel in the contour (<=> there is a neighboor pixel != pixel color)
+			coloredMap->borderPixels(y, r, atBorder);
+			
+			// We add the pixels to the region
+			for (unsigned x = r->xBegin; x < r->xEnd; ++x)
+				region->add(PixLoc(x,y), atBorder[x - r->xBegin], wcs.sun_center, pixelAreaArcsec2, pixelAreaArcsec2Uncertainity, pixelAreaMm2 * (correctionFactors[x] > HIGGINS_FACTOR ? HIGGINS_FACTOR : correctionFactors[x]), uncertainities[x]);
+			if(keepSpans)
+				region->addSpan(y, r->xBegin, r->xEnd);
+		}
+	}
+	DeprojectedAreaMap::release(areaMap);
+	return values(regions);
+}
+
 FitsFile& writeRegions(FitsFile& file, const vector<Region*>& regions)
 {
 	{
@@ -8,13 +8,26 @@
 #include <ctime>
 #include <string>
 #include <set>
+#include <vector>
 
 #include "constants.h"
 #include "tools.h"
 #include "Coordinate.h"
 #include "ColorMap.h"
+#include "RunLengthColorMap.h"
 #include "FitsFile.h"
 
+//! Horizontal span of pixels [xBegin, xEnd) of the row y of a region
+class RegionSpan
+{
+	public :
+		unsigned y, xBegin, xEnd;
+
+		RegionSpan(const unsigned y = 0, const unsigned xBegin = 0, const unsigned xEnd = 0)
+		:y(y), xBegin(xBegin), xEnd(xEnd)
+		{}
+};
+
 //! Class to obtain information about the position in space and time of a region
 
 class Region
@@ -50,6 +63,9 @@ class Region
 		//! Accumulators to compute the area and the errors
 		Real centerxError, centeryError, areaProjected, areaProjectedUncertainity, areaDeprojected, areaDeprojectedUncertainity;
 		
+		//! The spans of pixels of the region, ordered by row and then by column, if they were kept by getRegions
+		std::vector<RegionSpan> spans;
+		
 	public :
 		//! Constructor
 		Region(const unsigned id = 0);
@@ -130,6 +146,23 @@ class Region
 		//! Routine to update a region with a new pixel coordinate
 		void add(const PixLoc& coordinate, const bool& atBorder, const RealPixLoc& sunCenter, const Real& sun_radius, const Real pixelLength, const Real pixelWidth);
 		
+		//! Routine to update a region with a new pixel coordinate, and the contributions of the pixel to the areas
+		/*! The contributions are the ones of a pixel that is not at the border, see deprojectedPixelArea */
+		void add(const PixLoc& coordinate, const bool& atBorder, const RealPixLoc& sunCenter, const Real pixelAreaArcsec2, const Real pixelAreaArcsec2Uncertainity, const Real pixelAreaMm2, const Real pixelAreaMm2Uncertainity);
+		
+		//! Routine to add the span of pixels [xBegin, xEnd) of row y to the spans of the region
+		/*! The spans must be added row by row and from left to right, a span that continues the last one is merged with it */
+		void addSpan(const unsigned y, const unsigned xBegin, const unsigned xEnd);
+		
+		//! Accessor to retrieve the spans of pixels of the region
+		const std::vector<RegionSpan>& Spans() const;
+		
+		//! Routine that tells if the region has its spans of pixels
+		bool hasSpans() const;
+		
+		//! Routine that computes the area on the solar sphere (Mm²) of a pixel, corrected by the Higgins factor, and its uncertainty
+		static void deprojectedPixelArea(const PixLoc& coordinate, const RealPixLoc& sunCenter, const Real& sun_radius, Real& area, Real& uncertainity);
+		
 		//! Routine that generate a chaincode for the connected component indicated by firstPixel
 		std::vector<PixLoc> chainCode(const ColorMap* image, const unsigned min_points, const unsigned max_points, Real max_deviation = 0.) const;
 
@@ -141,8 +174,11 @@ class Region
 //! Extraction of the regions from a ColorMap
 /*
 @param map A map of the region, each one must have a different color
+@param keepSpans If the regions must keep their spans of pixels (see Region::Spans)
+The rows are scanned in parallel, by blocks, to find the pixels of the regions and compute their contributions to the areas,
+the contributions are then added to the regions in the order of the pixels, so that the regions do not depend on the number of threads
 */
-std::vector<Region*> getRegions(const ColorMap* coloredMap);
+std::vector<Region*> getRegions(const ColorMap* coloredMap, const bool keepSpans = false);
 
 //! Extraction of the regions from a ColorMap
 /*
@@ -151,6 +187,14 @@ std::vector<Region*> getRegions(const ColorMap* coloredMap);
 */
 std::vector<Region*> getRegions(const ColorMap* coloredMap, const std::set<ColorType>& colors);
 
+//! Extraction of the regions from a RunLengthColorMap
+/*
+@param map A map of the region, each one must have a different color
+@param keepSpans If the regions must keep their spans of pixels (see Region::Spans)
+The regions are the same than for the ColorMap, but only the runs of pixels are visited
+*/
+std::vector<Region*> getRegions(const RunLengthColorMap* coloredMap, const bool keepSpans = false);
+
 //! Write the regions into a fits file as column into the current table
 FitsFile& writeRegions(FitsFile& file, const std::vector<Region*>& regions);
 
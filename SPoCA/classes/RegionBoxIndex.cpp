@@ -0,0 +1,65 @@
+#include "RegionBoxIndex.h"
+#include <algorithm>
+
+//!@file RegionBoxIndex.cpp
+
+using namespace std;
+
+RegionBoxIndex::RegionBoxIndex(const vector<Region*>& regions, const unsigned cellSize)
+:cellSize(cellSize > 0 ? cellSize : 1), xCells(0), yCells(0), boxmin(regions.size()), boxmax(regions.size())
+{
+	for(unsigned r = 0; r < regions.size(); ++r)
+	{
+		boxmin[r] = regions[r]->Boxmin();
+		boxmax[r] = regions[r]->Boxmax();
+		xCells = max(xCells, boxmax[r].x / this->cellSize + 1);
+		yCells = max(yCells, boxmax[r].y / this->cellSize + 1);
+	}
+	cells.resize(xCells * yCells);
+
+	// The regions are added in increasing order, so the indices of a cell are sorted
+	for(unsigned r = 0; r < regions.size(); ++r)
+	{
+		for(unsigned cy = boxmin[r].y / this->cellSize; cy <= boxmax[r].y / this->cellSize; ++cy)
+		{
+			for(unsigned cx = boxmin[r].x / this->cellSize; cx <= boxmax[r].x / this->cellSize; ++cx)
+			{
+				cells[cy * xCells + cx].push_back(r);
+			}
+		}
+	}
+}
+
+void RegionBoxIndex::candidates(const PixLoc& queryBoxmin, const PixLoc& queryBoxmax, vector<unsigned>& indices) const
+{
+	indices.clear();
+	if(queryBoxmin.x > queryBoxmax.x || queryBoxmin.y > queryBoxmax.y)
+		return;
+
+	// The boxes of the regions all lie in the grid, so the query is clipped to it
+	const unsigned cxMin = queryBoxmin.x / cellSize;
+	const unsigned cyMin = queryBoxmin.y / cellSize;
+	if(cxMin >= xCells || cyMin >= yCells)
+		return;
+	const unsigned cxMax = min(queryBoxmax.x / cellSize, xCells - 1);
+	const unsigned cyMax = min(queryBoxmax.y / cellSize, yCells - 1);
+
+	for(unsigned cy = cyMin; cy <= cyMax; ++cy)
+	{
+		for(unsigned cx = cxMin; cx <= cxMax; ++cx)
+		{
+			const vector<unsigned>& cell = cells[cy * xCells + cx];
+			for(unsigned i = 0; i < cell.size(); ++i)
+			{
+				const unsigned r = cell[i];
+				// A cell can be shared by boxes that do not intersect the query
+				if(boxmin[r].x <= queryBoxmax.x && queryBoxmin.x <= boxmax[r].x && boxmin[r].y <= queryBoxmax.y && queryBoxmin.y <= boxmax[r].y)
+					indices.push_back(r);
+			}
+		}
+	}
+
+	// A region whose box spans several cells is found once per cell
+	sort(indices.begin(), indices.end());
+	indices.erase(unique(indices.begin(), indices.end()), indices.end());
+}
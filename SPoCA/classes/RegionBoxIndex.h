@@ -0,0 +1,55 @@
+#pragma once
+#ifndef RegionBoxIndex_H
+#define RegionBoxIndex_H
+
+#include <vector>
+#include <limits>
+
+#include "constants.h"
+#include "Coordinate.h"
+#include "Region.h"
+
+//! Class that finds the regions of a map whose box intersects a box
+/*!
+The plane of the map is divided in a uniform grid of square cells of cellSize pixels,
+and each cell keeps the indices of the regions whose box intersects it.
+A query only visits the cells intersected by the query box, so that the regions far from it are never compared.
+
+It is used by the tracking to compare only the pairs of regions that can overlay (see trackingBox).
+*/
+
+class RegionBoxIndex
+{
+	private :
+		//! Size in pixels of the side of a cell
+		unsigned cellSize;
+
+		//! Number of cells along the X axes
+		unsigned xCells;
+
+		//! Number of cells along the Y axes
+		unsigned yCells;
+
+		//! The lower left corner of the box of the regions
+		std::vector<PixLoc> boxmin;
+
+		//! The upper right corner of the box of the regions
+		std::vector<PixLoc> boxmax;
+
+		//! For each cell, the indices of the regions whose box intersects it
+		std::vector<std::vector<unsigned> > cells;
+
+	public :
+		//! Constructor
+		/*! @param regions The regions to index, the indices returned by candidates are the ones in this vector */
+		RegionBoxIndex(const std::vector<Region*>& regions, const unsigned cellSize = 64);
+
+		//! Accessor to retrieve the number of regions indexed
+		unsigned NumberRegions() const
+		{return boxmin.size();}
+
+		//! Routine that returns the indices of the regions whose box intersects the box [queryBoxmin, queryBoxmax], in increasing order
+		void candidates(const PixLoc& queryBoxmin, const PixLoc& queryBoxmax, std::vector<unsigned>& indices) const;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "RegionReachability.h"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+
+//!@file RegionReachability.cpp
+
+using namespace std;
+
+//! Number of bits in a word of a bitset
+static const unsigned wordBits = sizeof(unsigned long) * 8;
+
+//! Routine that returns the bits [offset, offset + wordBits) of a bitset, the bits after its end are 0
+static inline unsigned long bitsAt(const vector<unsigned long>& bits, const unsigned offset)
+{
+	const unsigned w = offset / wordBits;
+	const unsigned shift = offset % wordBits;
+	unsigned long result = w < bits.size() ? bits[w] >> shift : 0;
+	if(shift != 0 && w + 1 < bits.size())
+		result |= bits[w + 1] << (wordBits - shift);
+	return result;
+}
+
+RegionReachability::RegionReachability(const vector<vector<Region*> >& regions, const vector<ColorMap*>& images, const vector<unsigned>& order, const unsigned maxDeltaT)
+:position(images.size(), 0), firstNode(order.size() + 1, 0), windowBegin(order.size(), 0)
+{
+	unsigned p0 = 0;
+	for(unsigned p = 0; p < order.size(); ++p)
+	{
+		position[order[p]] = p;
+		firstNode[p + 1] = firstNode[p] + regions[order[p]].size();
+		// The first image at most maxDeltaT seconds before, the images being ordered by time
+		while(unsigned(difftime(images[order[p]]->ObservationTime(), images[order[p0]]->ObservationTime())) > maxDeltaT)
+			++p0;
+		windowBegin[p] = firstNode[p0];
+	}
+	ancestors.resize(firstNode[order.size()]);
+	sons.resize(firstNode[order.size()]);
+}
+
+bool RegionReachability::addAncestors(const unsigned from, const unsigned fromPosition, const unsigned to, const unsigned toPosition)
+{
+	const unsigned begin = windowBegin[toPosition];
+	const unsigned end = firstNode[toPosition];
+	if(begin >= end)
+		return false;
+
+	// The bitset is only allocated when the region gets its first ancestor
+	vector<unsigned long>& bits = ancestors[to];
+	if(bits.empty())
+		bits.resize((end - begin + wordBits - 1) / wordBits, 0);
+
+	bool added = false;
+	if(from >= begin)
+	{
+		const unsigned long bit = 1UL << ((from - begin) % wordBits);
+		unsigned long& word = bits[(from - begin) / wordBits];
+		added = (word & bit) == 0;
+		word |= bit;
+	}
+
+	// The ancestors of from are before it, and the window of to does not start before the window of from
+	const vector<unsigned long>& fromBits = ancestors[from];
+	const unsigned fromBegin = windowBegin[fromPosition];
+	const unsigned fromEnd = firstNode[fromPosition];
+	if(fromBits.empty() || fromEnd <= begin)
+		return added;
+	const unsigned numberWords = min(unsigned(bits.size()), (fromEnd - begin + wordBits - 1) / wordBits);
+	for(unsigned w = 0; w < numberWords; ++w)
+	{
+		const unsigned long newBits = bitsAt(fromBits, begin - fromBegin + w * wordBits) & ~bits[w];
+		if(newBits != 0)
+		{
+			bits[w] |= newBits;
+			added = true;
+		}
+	}
+	return added;
+}
+
+bool RegionReachability::path(const unsigned s1, const unsigned r1, const unsigned s2, const unsigned r2) const
+{
+	const unsigned from = node(s1, r1);
+	const unsigned to = node(s2, r2);
+	// The edges go to later images
+	if(position[s1] >= position[s2])
+		return from == to;
+	const unsigned begin = windowBegin[position[s2]];
+	if(from < begin)
+	{
+		cerr<<"Error : cannot test the path between 2 regions more than maxDeltaT seconds apart."<<endl;
+		exit(EXIT_FAILURE);
+	}
+	const vector<unsigned long>& bits = ancestors[to];
+	if(bits.empty())
+		return false;
+	return (bits[(from - begin) / wordBits] >> ((from - begin) % wordBits)) & 1UL;
+}
+
+void RegionReachability::add_edge(const unsigned s1, const unsigned r1, const unsigned s2, const unsigned r2)
+{
+	const unsigned from = node(s1, r1);
+	const unsigned fromPosition = position[s1];
+	if(fromPosition >= position[s2] || from < windowBegin[position[s2]])
+	{
+		cerr<<"Error : an edge must go to a region at most maxDeltaT seconds later."<<endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// We add the ancestors to the descendants of the edge, a descendant that already has them has passed them to its own
+	vector<unsigned> stack(1, node(s2, r2));
+	vector<unsigned> stackPositions(1, position[s2]);
+	while(! stack.empty())
+	{
+		const unsigned to = stack.back();
+		const unsigned toPosition = stackPositions.back();
+		stack.pop_back();
+		stackPositions.pop_back();
+		if(! addAncestors(from, fromPosition, to, toPosition))
+			continue;
+		for(unsigned i = 0; i < sons[to].size(); ++i)
+		{
+			const unsigned son = sons[to][i];
+			stack.push_back(son);
+			stackPositions.push_back(upper_bound(firstNode.begin(), firstNode.end(), son) - firstNode.begin() - 1);
+		}
+	}
+	sons[from].push_back(node(s2, r2));
+}
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef RegionReachability_H
+#define RegionReachability_H
+
+#include <vector>
+
+#include "constants.h"
+#include "ColorMap.h"
+#include "Region.h"
+
+//! Class that tells if there is a path between 2 regions of a tracking graph, without searching the graph
+/*!
+The regions are given by image, and the images are ordered by time.
+The edges of a tracking graph go from a region to a region of a later image, so a path between 2 regions
+only goes through regions of the images between theirs.
+
+Each region keeps as a bitset its ancestors (the regions that have a path to it) in the images at most maxDeltaT seconds before its own.
+When an edge is added, the ancestors of its origin are added to its destination and to the descendants of it, until a region already has them.
+The test of a path is then the test of a bit, as long as the 2 regions are at most maxDeltaT seconds apart, which is the case of all the pairs compared by the tracking.
+
+The regions are numbered in the order of the images, so the ancestors of a region all have a smaller number.
+*/
+
+class RegionReachability
+{
+	private :
+		//! For each image, its position in the time order
+		std::vector<unsigned> position;
+
+		//! For each position, the number of the first region of the image, and the number of regions for the last one
+		std::vector<unsigned> firstNode;
+
+		//! For each position, the number of the first region of the first image at most maxDeltaT seconds before
+		std::vector<unsigned> windowBegin;
+
+		//! For each region, the bits of its ancestors, starting from the windowBegin of its image
+		std::vector<std::vector<unsigned long> > ancestors;
+
+		//! For each region, the regions it has an edge to
+		std::vector<std::vector<unsigned> > sons;
+
+		//! Routine that returns the number of the region r of image s
+		unsigned node(const unsigned s, const unsigned r) const
+		{return firstNode[position[s]] + r;}
+
+		//! Routine that adds the region from and its ancestors to the ancestors of the region to, returns true if some were new
+		bool addAncestors(const unsigned from, const unsigned fromPosition, const unsigned to, const unsigned toPosition);
+
+	public :
+		//! Constructor
+		/*!
+		@param regions The regions of each image
+		@param images The images
+		@param order The indices of the images ordered by time (see imageOrder)
+		@param maxDeltaT The maximal number of seconds between 2 regions whose path will be tested
+		*/
+		RegionReachability(const std::vector<std::vector<Region*> >& regions, const std::vector<ColorMap*>& images, const std::vector<unsigned>& order, const unsigned maxDeltaT);
+
+		//! Tell if there is a path from the region r1 of image s1 to the region r2 of image s2
+		/*! Image s1 must be at most maxDeltaT seconds before image s2 */
+		bool path(const unsigned s1, const unsigned r1, const unsigned s2, const unsigned r2) const;
+
+		//! Routine to add the edge from the region r1 of image s1 to the region r2 of image s2
+		/*! It must be added to the RegionGraph too, image s1 must be at most maxDeltaT seconds before image s2 */
+		void add_edge(const unsigned s1, const unsigned r1, const unsigned s2, const unsigned r2);
+};
+
+#endif
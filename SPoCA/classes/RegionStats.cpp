@@ -1,16 +1,33 @@
 #include "RegionStats.h"
+#include "StatsEngine.h"
 
 using namespace std;
 
 RegionStats::RegionStats(const time_t& observationTime, const unsigned id)
-:id(id),observationTime(observationTime), numberPixels(0), numberGoodPixels(0), m2(NAN), m3(NAN), m4(NAN), minIntensity(NAN), maxIntensity(NAN), totalIntensity(0), centerxError(0), centeryError(0), area_Raw(0), area_RawUncert(0), area_AtDiskCenter(0), area_AtDiskCenterUncert(0), numberContourPixels(0), center(0,0), barycenter(0,0), clipped_spatial(false)
+:id(id),observationTime(observationTime), numberPixels(0), numberGoodPixels(0), minIntensity(NAN), maxIntensity(NAN), totalIntensity(0), centerxError(0), centeryError(0), area_Raw(0), area_RawUncert(0), area_AtDiskCenter(0), area_AtDiskCenterUncert(0), numberContourPixels(0), center(0,0), barycenter(0,0), clipped_spatial(false)
 {}
 
 
 void RegionStats::add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const bool& atBorder, const Real& sun_radius)
 {
-
+	Real dx = fabs(coordinate.x - sunCenter.x);
+	Real dy = fabs(coordinate.y - sunCenter.y);
+	Real radius_squared = sun_radius * sun_radius;
+	Real sigma = radius_squared - (dx * dx) - (dy * dy);
+	
+	// We compute the contribution of the pixel to the raw area in Mm², and it's uncertainity
+	const Real raw_pixel_area = (SUN_RADIUS) * (SUN_RADIUS) / radius_squared;
+	const Real raw_pixel_area_uncert = 2 * raw_pixel_area * ((SUN_RADIUS_VARIATION / SUN_RADIUS) + (SUN_RADIUS_VARIATION_PIXELS / sun_radius));
 	
+	// We compute the correction factor of the pixel to the area at disk center, and it's uncertainity
+	const Real area_correction_factor = sigma > 0 ? sun_radius/sqrt(sigma) : numeric_limits<Real>::infinity();
+	const Real area_uncert = (raw_pixel_area / sqrt(sigma*sigma*sigma)) * (dx + dy + (2 * (SUN_RADIUS_VARIATION / SUN_RADIUS) * sigma) + ((SUN_RADIUS_VARIATION_PIXELS / sun_radius) * (radius_squared + sigma)));
+	
+	add(coordinate, pixelIntensity, sunCenter, atBorder, raw_pixel_area, raw_pixel_area_uncert, area_correction_factor, area_uncert);
+}
+
+void RegionStats::add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const bool& atBorder, const Real raw_pixel_area, const Real raw_pixel_area_uncert, const Real area_correction_factor, const Real area_uncert)
+{
 	// If the intensity is not a number, the event is said to be clipped spatially
 	if(isnan(pixelIntensity) || isinf(pixelIntensity))
 	{
@@ -29,23 +46,13 @@ void RegionStats::add(const PixLoc& coordinate, const EUVPixelType& pixelIntensi
 		barycenter.x += coordinate.x * pixelIntensity;
 		barycenter.y += coordinate.y * pixelIntensity;
 		
-		// We keep a vector of intensities to compute the variance, the skewness and the kurtosis
-		intensities.push_back(pixelIntensity);
-		
-		// If I add an intensity, the previously computed moment of order > 1 are invalid
-		m2 = NAN;
-		m3 = NAN;
-		m4 = NAN;
+		// We keep the distribution of intensities to compute the variance, the skewness, the kurtosis and the quantiles
+		intensities.add(pixelIntensity);
 		
 		// Increase the number of good pixels
 		++numberGoodPixels;
 	}
 	
-	Real dx = fabs(coordinate.x - sunCenter.x);
-	Real dy = fabs(coordinate.y - sunCenter.y);
-	Real radius_squared = sun_radius * sun_radius;
-	Real sigma = radius_squared - (dx * dx) - (dy * dy);
-	
 	++numberPixels;
 	
 	// We compute the center
@@ -56,25 +63,18 @@ void RegionStats::add(const PixLoc& coordinate, const EUVPixelType& pixelIntensi
 	centerxError = fabs(center.x/numberPixels - sunCenter.x);
 	centeryError = fabs(center.y/numberPixels - sunCenter.y);
 	
-	// We compute the contribution of the pixel to the raw area in Mm², and it's uncertainity
-	const Real raw_pixel_area = (SUN_RADIUS) * (SUN_RADIUS) / radius_squared;
-	
+	// We add the contribution of the pixel to the raw area in Mm², and it's uncertainity
 	area_Raw += raw_pixel_area;
-	area_RawUncert += 2 * raw_pixel_area * ((SUN_RADIUS_VARIATION / SUN_RADIUS) + (SUN_RADIUS_VARIATION_PIXELS / sun_radius));
+	area_RawUncert += raw_pixel_area_uncert;
 	if(atBorder)
 		area_RawUncert += raw_pixel_area;
 	
-	// We compute the contribution of the pixel to the area at disk center in Mm², and it's uncertainity
-	Real area_correction_factor = HIGGINS_FACTOR + 1;
-	if(sigma > 0)
-		area_correction_factor = sun_radius/sqrt(sigma);
-
 	// If the area correction factor is more than some value (i.e. the pixel is near the limb)
 	// we mark that the area at disk center will be invalid
 	if (area_correction_factor <= HIGGINS_FACTOR)
 	{
 		area_AtDiskCenter += raw_pixel_area * area_correction_factor;
-		area_AtDiskCenterUncert += (raw_pixel_area / sqrt(sigma*sigma*sigma)) * (dx + dy + (2 * (SUN_RADIUS_VARIATION / SUN_RADIUS) * sigma) + ((SUN_RADIUS_VARIATION_PIXELS / sun_radius) * (radius_squared + sigma)));
+		area_AtDiskCenterUncert += area_uncert;
 		if(atBorder)
 			area_AtDiskCenterUncert += raw_pixel_area * area_correction_factor;
 	}
@@ -173,7 +173,7 @@ Real RegionStats::Median() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.5);
+		return intensities.quantile(0.5);
 }
 
 Real RegionStats::LowerQuartile() const
@@ -181,7 +181,7 @@ Real RegionStats::LowerQuartile() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.25);
+		return intensities.quantile(0.25);
 }
 
 Real RegionStats::UpperQuartile() const
@@ -189,38 +189,15 @@ Real RegionStats::UpperQuartile() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.75);
+		return intensities.quantile(0.75);
 }
 
-void RegionStats::computeMoments()
-{
-	Real mean = Mean();
-	if(isnan(mean) || isinf(mean))
-	{
-		m2 = m3 = m4 = NAN;
-	}
-	else
-	{
-		m2 = m3 = m4 = 0;
-		for (unsigned i = 0; i < intensities.size(); ++i)
-		{
-			Real delta = intensities[i] - mean;
-			Real delta2 = delta * delta;
-			m2 += delta2;
-			m4 += delta2 * delta2;
-			m3 += delta2 * delta;
-		}
-	}
-}
 Real RegionStats::Variance() const
 {
 	if (intensities.size() == 0)
 		return NAN;
-	if(isnan(m2))
-	{
-		const_cast<RegionStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2();
+	
 	if (isinf(m2) || isnan(m2))
 		return NAN;
 	else
@@ -232,11 +209,8 @@ Real RegionStats::Skewness() const
 {
 	if (intensities.size() == 0)
 		return NAN;
-	if(isnan(m2) || isnan(m3))
-	{
-		const_cast<RegionStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2(), m3 = intensities.M3();
+	
 	if (isinf(m3) || isnan(m3) || isinf(m2) || isnan(m2) || m2 <= 0)
 		return NAN;
 	else
@@ -248,11 +222,8 @@ Real RegionStats::Kurtosis() const
 {
 	if(intensities.size() == 0)
 		return NAN;
-	if(isnan(m2) || isnan(m4))
-	{
-		const_cast<RegionStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2(), m4 = intensities.M4();
+	
 	if (isinf(m4) || isnan(m4) || isinf(m2) || isnan(m2) || m2 <= 0)
 		return NAN;
 	else
@@ -310,105 +281,23 @@ string RegionStats::toString(const string& separator, bool header) const
 
 vector<RegionStats*> getRegionStats(const ColorMap* coloredMap, const EUVImage* image, const vector<Region*>& regions)
 {
-	map<ColorType,RegionStats*> regions_stats;
-	for(unsigned r = 0; r < regions.size(); ++r)
-	{
-		if (regions_stats.count(regions[r]->Color()) == 0)
-			regions_stats[regions[r]->Color()] = new RegionStats(image->ObservationTime(), regions[r]->Id());
-	}
-	
-	RealPixLoc sunCenter = image->SunCenter();
-	Real sunRadius = image->SunRadius();
-	
-	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
-	{
-		for (unsigned x = 0; x < coloredMap->Xaxes(); ++x)
-		{
-			if(coloredMap->pixel(x,y) != coloredMap->null())
-			{
-				const ColorType& color = coloredMap->pixel(x,y);
-				
-				// We only compute the region stats for the given regions
-				if (regions_stats.count(color) > 0)
-				{
-					//Is the pixel in the contour (<=> there is a neighboor pixel != pixel color)
-					bool atBorder = coloredMap->pixel(x-1,y) != color || coloredMap->pixel(x+1,y) != color || coloredMap->pixel(x,y-1) != color || coloredMap->pixel(x,y+1) != color;
-				
-					// We add the pixel to the region
-					regions_stats[color]->add(PixLoc(x,y), image->pixel(x, y), sunCenter, atBorder, sunRadius);
-				}
-			}
-		}
-	}
-	
-	return values(regions_stats);
+	StatsEngine engine(coloredMap, StatsEngine::REGION_STATS);
+	engine.setRegions(regions);
+	return engine.compute(image).regionStats;
 }
 
-
 vector<RegionStats*> getRegionStats(const ColorMap* coloredMap, const EUVImage* image)
 {
-	unsigned id = 0;
-	map<ColorType,RegionStats*> regions_stats;
-	
-	RealPixLoc sunCenter = image->SunCenter();
-	Real sunRadius = image->SunRadius();
-	
-	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
-	{
-		for (unsigned x = 0; x < coloredMap->Xaxes(); ++x)
-		{
-			if(coloredMap->pixel(x,y) != coloredMap->null())
-			{
-				const ColorType& color = coloredMap->pixel(x,y);
-				
-				// If the regions_stats does not yet exist we create it
-				if (regions_stats.count(color) == 0)
-				{
-					regions_stats[color] = new RegionStats(image->ObservationTime(), id);
-					++id;
-				}
-				
-				// Is the pixel in the contour (<=> there is a neighboor pixel != pixel color)
-				bool atBorder = coloredMap->pixel(x-1,y) != color || coloredMap->pixel(x+1,y) != color || coloredMap->pixel(x,y-1) != color || coloredMap->pixel(x,y+1) != color;
-				
-				// We add the pixel to the region
-				regions_stats[color]->add(PixLoc(x,y), image->pixel(x, y), sunCenter, atBorder, sunRadius);
-			}
-		}
-	}
-	
-	return values(regions_stats);
+	StatsEngine engine(coloredMap, StatsEngine::REGION_STATS);
+	return engine.compute(image).regionStats;
 }
 
 vector<SegmentationStats*> getTotalRegionStats(const ColorMap* coloredMap, const EUVImage* image)
 {
-	vector<SegmentationStats*> regions_stats;
-	regions_stats.push_back(new SegmentationStats(image->ObservationTime(), 0));
-	regions_stats.push_back(new SegmentationStats(image->ObservationTime(), 1));
-	
-	RealPixLoc sunCenter = image->SunCenter();
-	Real sunRadius = image->SunRadius();
-	
-	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
-	{
-		for (unsigned x = 0; x < coloredMap->Xaxes(); ++x)
-		{
-			if(coloredMap->pixel(x,y) != coloredMap->null())
-			{
-				regions_stats[1]->add(PixLoc(x,y), image->pixel(x, y), sunCenter, sunRadius);
-			}
-			else
-			{
-				regions_stats[0]->add(PixLoc(x,y), image->pixel(x, y), sunCenter, sunRadius);
-			}
-		}
-	}
-	
-	return regions_stats;
+	StatsEngine engine(coloredMap, StatsEngine::TOTAL_REGION_STATS);
+	return engine.compute(image).totalRegionStats;
 }
 
-
-
 FitsFile& writeRegions(FitsFile& file, const vector<RegionStats*>& regions_stats)
 {
 	{
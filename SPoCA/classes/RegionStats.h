@@ -4,7 +4,6 @@
 
 #include <limits>
 #include <cmath>
-#include <deque>
 #include <set>
 
 #include "constants.h"
@@ -13,6 +12,7 @@
 #include "EUVImage.h"
 #include "ColorMap.h"
 #include "FitsFile.h"
+#include "IntensityDistribution.h"
 #include "Region.h"
 #include "SegmentationStats.h"
 
@@ -36,16 +36,12 @@ class RegionStats
 		//! Number of good pixels in the region, i.e. pixels that are not null
 		unsigned numberGoodPixels;
 		
-		// Moments
-		mutable Real m2, m3, m4;
 		Real minIntensity, maxIntensity, totalIntensity, centerxError, centeryError, area_Raw, area_RawUncert, area_AtDiskCenter, area_AtDiskCenterUncert, numberContourPixels;
 		//! Coordinates of the center of the region
 		RealPixLoc center, barycenter;
 		bool clipped_spatial;
-		mutable std::deque<EUVPixelType> intensities;
-	private :
-		//! Routine to compute the moments from the pixel intensities vector
-		void computeMoments();
+		//! The intensities of the good pixels, to compute the moments and the quantiles
+		IntensityDistribution intensities;
 
 	public :
 		//! Constructor
@@ -111,6 +107,9 @@ class RegionStats
 
 		//! Routine to update a region with a new pixel
 		void add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const bool& atBorder, const Real& R);
+		
+		//! Routine to update a region with a new pixel, and the terms of the area of the pixel (see DeprojectedAreaMap)
+		void add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const bool& atBorder, const Real raw_pixel_area, const Real raw_pixel_area_uncert, const Real area_correction_factor, const Real area_uncert);
 };
 
 //! Compute all statistics of an image using a ColorMap as a cache
@@ -0,0 +1,280 @@
+#include "RemapTable.h"
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <pthread.h>
+
+#include "SunImage.h"
+#include "parallel.h"
+
+//!@file RemapTable.cpp
+
+using namespace std;
+
+const unsigned RemapTable::NO_SOURCE = numeric_limits<unsigned>::max();
+
+//! Tell if 2 values are the same, NAN being the same as NAN
+static inline bool same(const Real& a, const Real& b)
+{
+	return a == b || (isnan(a) && isnan(b));
+}
+
+//! Tell if 2 WCS describe the same geometry
+static bool sameGeometry(const WCS& a, const WCS& b)
+{
+	return same(a.sun_center.x, b.sun_center.x) && same(a.sun_center.y, b.sun_center.y) && same(a.sun_radius, b.sun_radius)
+		&& same(a.b0, b.b0) && same(a.l0, b.l0) && same(a.cos_b0, b.cos_b0) && same(a.sin_b0, b.sin_b0)
+		&& same(a.dsun_obs, b.dsun_obs) && same(a.sunradius_Mm, b.sunradius_Mm)
+		&& same(a.cd[0][0], b.cd[0][0]) && same(a.cd[0][1], b.cd[0][1]) && same(a.cd[1][0], b.cd[1][0]) && same(a.cd[1][1], b.cd[1][1])
+		&& same(a.icd[0][0], b.icd[0][0]) && same(a.icd[0][1], b.icd[0][1]) && same(a.icd[1][0], b.icd[1][0]) && same(a.icd[1][1], b.icd[1][1]);
+}
+
+//! Functor to build the rows of a RemapTable in parallel
+class RemapTableBuilder
+{
+	private :
+		RemapTable* table;
+	public :
+		RemapTableBuilder(RemapTable* table)
+		:table(table)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			table->build(beginRow, endRow);
+		}
+};
+
+RemapTable::RemapTable(const WCS& destinationWCS, const unsigned xAxes, const unsigned yAxes, const WCS& sourceWCS, const unsigned sourceXAxes, const unsigned sourceYAxes, const int delta_t, const Mapping mapping)
+:destinationWCS(destinationWCS), xAxes(xAxes), yAxes(yAxes), sourceWCS(sourceWCS), sourceXAxes(sourceXAxes), sourceYAxes(sourceYAxes), delta_t(delta_t), mapping(mapping), indices(xAxes * yAxes, NO_SOURCE), xWeights(xAxes * yAxes, 0), yWeights(xAxes * yAxes, 0), rowBegin(yAxes, 0), rowEnd(yAxes, 0), references(0)
+{
+	RemapTableBuilder builder(this);
+	parallel_for_rows(yAxes, builder);
+}
+
+void RemapTable::build(const unsigned beginRow, const unsigned endRow)
+{
+	// We use empty images to do the coordinate conversions
+	const SunImage<ColorType> destination(destinationWCS);
+	const SunImage<ColorType> source(sourceWCS);
+	vector<Real> longitude, latitude, locationX, locationY;
+	if(mapping == DEROTATION)
+	{
+		longitude.resize(xAxes);
+		latitude.resize(xAxes);
+		locationX.resize(xAxes);
+		locationY.resize(xAxes);
+	}
+
+	for(unsigned y = beginRow; y < endRow; ++y)
+	{
+		rowBegin[y] = xAxes;
+		rowEnd[y] = 0;
+		if(xAxes == 0)
+			continue;
+
+		if(mapping == DEROTATION)
+			buildDerotationRow(y, destination, source, longitude, latitude, locationX, locationY);
+		else
+			buildProjectionRow(y);
+
+		if(rowBegin[y] > rowEnd[y])
+			rowBegin[y] = rowEnd[y];
+	}
+}
+
+void RemapTable::setSource(const unsigned x, const unsigned y, float sourceX, float sourceY)
+{
+	// We do the same clipping than Image::interpolate
+	sourceX = sourceX < 0. ? 0. : min(float(sourceXAxes - 1.001), sourceX);
+	sourceY = sourceY < 0. ? 0. : min(float(sourceYAxes - 1.001), sourceY);
+	unsigned ix = (unsigned) sourceX;
+	unsigned iy = (unsigned) sourceY;
+	const unsigned j = y * xAxes + x;
+	indices[j] = iy * sourceXAxes + ix;
+	xWeights[j] = sourceX - ix;
+	yWeights[j] = sourceY - iy;
+
+	if(x < rowBegin[y])
+		rowBegin[y] = x;
+	if(x + 1 > rowEnd[y])
+		rowEnd[y] = x + 1;
+}
+
+void RemapTable::buildDerotationRow(const unsigned y, const SunImage<ColorType>& destination, const SunImage<ColorType>& source, vector<Real>& longitude, vector<Real>& latitude, vector<Real>& locationX, vector<Real>& locationY)
+{
+	destination.toHGS(y, 0, xAxes, &(longitude[0]), &(latitude[0]));
+	for(unsigned x = 0; x < xAxes; ++x)
+	{
+		if(isfinite(longitude[x]) && isfinite(latitude[x]))
+		{
+			longitude[x] += delta_t * SunDifferentialAngularSpeed(latitude[x]);
+			// Pixels rotated behind the limb have no source
+			if(longitude[x] > MIPI || longitude[x] < -MIPI)
+				longitude[x] = INF;
+		}
+	}
+	source.toRealPixLoc(xAxes, &(longitude[0]), &(latitude[0]), &(locationX[0]), &(locationY[0]));
+
+	for(unsigned x = 0; x < xAxes; ++x)
+	{
+		if(isfinite(locationX[x]) && isfinite(locationY[x]))
+			setSource(x, y, locationX[x], locationY[x]);
+	}
+}
+
+void RemapTable::buildProjectionRow(const unsigned py)
+{
+	// We use the same formulas as the approximate projections and deprojections of SunImage
+	switch(mapping)
+	{
+		case EQUIRECTANGULAR_PROJECTION :
+		case LAMBERT_CYLINDRICAL_PROJECTION :
+		case SINUSOIDAL_PROJECTION :
+		{
+			Real sun_radius = sourceWCS.sun_radius;
+			RealPixLoc sun_center = sourceWCS.sun_center;
+			Real dx = PI / Real(xAxes);
+			Real latitude;
+			if(mapping == LAMBERT_CYLINDRICAL_PROJECTION)
+				latitude = asin((py * (2. / Real(yAxes))) - 1.);
+			else
+				latitude = (py * (PI / Real(yAxes))) - MIPI;
+			Real cos_lat = cos(latitude);
+			Real iy = sun_center.y + (sin(latitude) * sun_radius);
+			for(unsigned px = 0; px < xAxes; ++px)
+			{
+				Real longitude = (px * dx) - MIPI;
+				if(mapping == SINUSOIDAL_PROJECTION)
+				{
+					longitude /= cos_lat;
+					if(!(-MIPI <= longitude && longitude <= MIPI))
+						continue;
+				}
+				Real ix = sun_center.x + (sun_radius * cos_lat * sin(longitude));
+				setSource(px, py, ix, iy);
+			}
+			break;
+		}
+		case EQUIRECTANGULAR_DEPROJECTION :
+		case LAMBERT_CYLINDRICAL_DEPROJECTION :
+		case SINUSOIDAL_DEPROJECTION :
+		{
+			Real sun_radius = destinationWCS.sun_radius;
+			RealPixLoc sun_center = destinationWCS.sun_center;
+			Real dy = mapping == LAMBERT_CYLINDRICAL_DEPROJECTION ? Real(sourceYAxes) / 2. : Real(sourceYAxes) / PI;
+			Real dx = Real(sourceXAxes) / PI;
+			Real ry = Real(py - sun_center.y) / sun_radius;
+			if(ry <= 1. && ry >= -1.)
+			{
+				Real latitude = asin(ry);
+				Real cos_lat = cos(latitude);
+				for(unsigned ix = 0; ix < xAxes; ++ix)
+				{
+					Real rx = Real(ix - sun_center.x) / sun_radius;
+					if(rx*rx + ry*ry <= 1)
+					{
+						Real longitude = asin(rx / cos_lat);
+						if(mapping == EQUIRECTANGULAR_DEPROJECTION)
+							setSource(ix, py, (longitude + MIPI) * dx, (latitude + MIPI) * dy);
+						else if(mapping == LAMBERT_CYLINDRICAL_DEPROJECTION)
+							setSource(ix, py, (longitude + MIPI) * dx, (sin(latitude) + 1.) * dy);
+						else
+							setSource(ix, py, ((longitude * cos_lat) + MIPI) * dx, (latitude + MIPI) * dy);
+					}
+				}
+			}
+			break;
+		}
+		default :
+			break;
+	}
+}
+
+bool RemapTable::matches(const WCS& destinationWCS, const unsigned xAxes, const unsigned yAxes, const WCS& sourceWCS, const unsigned sourceXAxes, const unsigned sourceYAxes, const int delta_t, const Mapping mapping) const
+{
+	return this->mapping == mapping && this->xAxes == xAxes && this->yAxes == yAxes && this->sourceXAxes == sourceXAxes && this->sourceYAxes == sourceYAxes && this->delta_t == delta_t && sameGeometry(this->destinationWCS, destinationWCS) && sameGeometry(this->sourceWCS, sourceWCS);
+}
+
+//! The cached tables, the most recently used last
+static vector<RemapTable*> remapTableCache;
+
+//! Mutex protecting the cache
+static pthread_mutex_t remapTableCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+void RemapTable::evict(const unsigned maxUnused)
+{
+	unsigned unused = 0;
+	for(unsigned t = 0; t < remapTableCache.size(); ++t)
+		if(remapTableCache[t]->references == 0)
+			++unused;
+
+	for(vector<RemapTable*>::iterator t = remapTableCache.begin(); unused > maxUnused && t != remapTableCache.end();)
+	{
+		if((*t)->references == 0)
+		{
+			delete *t;
+			t = remapTableCache.erase(t);
+			--unused;
+		}
+		else
+		{
+			++t;
+		}
+	}
+}
+
+const RemapTable* RemapTable::get(const WCS& destinationWCS, const unsigned xAxes, const unsigned yAxes, const WCS& sourceWCS, const unsigned sourceXAxes, const unsigned sourceYAxes, const int delta_t, const Mapping mapping)
+{
+	pthread_mutex_lock(&remapTableCacheMutex);
+	for(unsigned t = 0; t < remapTableCache.size(); ++t)
+	{
+		RemapTable* table = remapTableCache[t];
+		if(table->matches(destinationWCS, xAxes, yAxes, sourceWCS, sourceXAxes, sourceYAxes, delta_t, mapping))
+		{
+			++table->references;
+			remapTableCache.erase(remapTableCache.begin() + t);
+			remapTableCache.push_back(table);
+			pthread_mutex_unlock(&remapTableCacheMutex);
+			return table;
+		}
+	}
+	pthread_mutex_unlock(&remapTableCacheMutex);
+
+	// We build the table without holding the lock, so that other threads can use the cache
+	RemapTable* table = new RemapTable(destinationWCS, xAxes, yAxes, sourceWCS, sourceXAxes, sourceYAxes, delta_t, mapping);
+
+	pthread_mutex_lock(&remapTableCacheMutex);
+	// Another thread may have built the same table in the mean time
+	for(unsigned t = 0; t < remapTableCache.size(); ++t)
+	{
+		if(remapTableCache[t]->matches(destinationWCS, xAxes, yAxes, sourceWCS, sourceXAxes, sourceYAxes, delta_t, mapping))
+		{
+			delete table;
+			table = remapTableCache[t];
+			remapTableCache.erase(remapTableCache.begin() + t);
+			break;
+		}
+	}
+	remapTableCache.push_back(table);
+	++table->references;
+	evict(REMAP_CACHE_SIZE);
+	pthread_mutex_unlock(&remapTableCacheMutex);
+	return table;
+}
+
+void RemapTable::release(const RemapTable* table)
+{
+	if(table == NULL)
+		return;
+	pthread_mutex_lock(&remapTableCacheMutex);
+	--table->references;
+	evict(REMAP_CACHE_SIZE);
+	pthread_mutex_unlock(&remapTableCacheMutex);
+}
+
+void RemapTable::clearCache()
+{
+	pthread_mutex_lock(&remapTableCacheMutex);
+	evict(0);
+	pthread_mutex_unlock(&remapTableCacheMutex);
+}
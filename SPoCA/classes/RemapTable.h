@@ -0,0 +1,163 @@
+#pragma once
+#ifndef RemapTable_H
+#define RemapTable_H
+
+#include <vector>
+
+#include "constants.h"
+#include "Coordinate.h"
+#include "WCS.h"
+
+template<class T> class SunImage;
+
+//! Class that gives, for each pixel of a destination sun image, the location in a source sun image it must be interpolated from
+/*!
+The location is obtained by converting the destination pixel to Heliographic Stonyhurst coordinates,
+by rotating it by delta_t seconds with the differential rotation of the sun, and converting it back to pixel location in the source.
+This is what SunImage::rotate, SunImage::shift_like and SunImage::shifted_like do for every pixel.
+
+Tables can also give the location of the pixels for the approximate heliographic projections and deprojections of SunImage
+(equirectangular, Lambert cylindrical and sinusoidal), in which case delta_t is not used.
+
+Because those conversions are costly, the table stores for each destination pixel the index of the lower left source pixel and the bilinear weights,
+so that applying it is a simple gather (see Image::remap).
+
+Tables are identified by the mapping, the geometry (WCS and size) of the destination and the source, and delta_t.
+They are obtained with RemapTable::get, that returns the table from a cache if a table with the same parameters was already built,
+and must be given back with RemapTable::release. The cache keeps at most REMAP_CACHE_SIZE unused tables (see @ref Compilation_Options).
+*/
+
+class RemapTable
+{
+	public :
+		//! Value of the source index for pixels that have no location in the source
+		static const unsigned NO_SOURCE;
+
+		//! Type of mapping between the destination and the source
+		enum Mapping {DEROTATION, EQUIRECTANGULAR_PROJECTION, EQUIRECTANGULAR_DEPROJECTION, LAMBERT_CYLINDRICAL_PROJECTION, LAMBERT_CYLINDRICAL_DEPROJECTION, SINUSOIDAL_PROJECTION, SINUSOIDAL_DEPROJECTION};
+
+	private :
+		//! WCS of the destination
+		WCS destinationWCS;
+
+		//! Size of the X axes of the destination
+		unsigned xAxes;
+
+		//! Size of the Y axes of the destination
+		unsigned yAxes;
+
+		//! WCS of the source
+		WCS sourceWCS;
+
+		//! Size of the X axes of the source
+		unsigned sourceXAxes;
+
+		//! Size of the Y axes of the source
+		unsigned sourceYAxes;
+
+		//! Number of seconds of rotation between the destination and the source
+		int delta_t;
+
+		//! Type of mapping
+		Mapping mapping;
+
+		//! For each destination pixel, the index of the lower left source pixel, or NO_SOURCE
+		std::vector<unsigned> indices;
+
+		//! For each destination pixel, the bilinear weight along x of the right source pixels
+		std::vector<float> xWeights;
+
+		//! For each destination pixel, the bilinear weight along y of the upper source pixels
+		std::vector<float> yWeights;
+
+		//! For each row of the destination, the first column that has a source
+		std::vector<unsigned> rowBegin;
+
+		//! For each row of the destination, the last column + 1 that has a source
+		std::vector<unsigned> rowEnd;
+
+		//! Number of users of the table
+		mutable unsigned references;
+
+		//! Routine that computes the locations of the rows [beginRow, endRow)
+		void build(const unsigned beginRow, const unsigned endRow);
+
+		//! Routine that computes the locations of the row y for the derotation
+		void buildDerotationRow(const unsigned y, const SunImage<ColorType>& destination, const SunImage<ColorType>& source, std::vector<Real>& longitude, std::vector<Real>& latitude, std::vector<Real>& locationX, std::vector<Real>& locationY);
+
+		//! Routine that computes the locations of the row y for the projections and deprojections
+		void buildProjectionRow(const unsigned y);
+
+		//! Routine that sets the location in the source of the destination pixel (x, y), clipped like in Image::interpolate
+		void setSource(const unsigned x, const unsigned y, float sourceX, float sourceY);
+
+		//! Routine that deletes the least recently used unused tables of the cache, until there is at most maxUnused left
+		static void evict(const unsigned maxUnused);
+
+		friend class RemapTableBuilder;
+
+	public :
+		//! Constructor, build the table
+		/*!
+		@param destinationWCS The WCS of the destination
+		@param xAxes The size of the X axes of the destination
+		@param yAxes The size of the Y axes of the destination
+		@param sourceWCS The WCS of the source
+		@param sourceXAxes The size of the X axes of the source
+		@param sourceYAxes The size of the Y axes of the source
+		@param delta_t The number of seconds of rotation to apply to the destination pixels to obtain their location in the source
+		@param mapping The type of mapping between the destination and the source
+		*/
+		RemapTable(const WCS& destinationWCS, const unsigned xAxes, const unsigned yAxes, const WCS& sourceWCS, const unsigned sourceXAxes, const unsigned sourceYAxes, const int delta_t, const Mapping mapping = DEROTATION);
+
+		//! Tell if the table has been built for those parameters
+		bool matches(const WCS& destinationWCS, const unsigned xAxes, const unsigned yAxes, const WCS& sourceWCS, const unsigned sourceXAxes, const unsigned sourceYAxes, const int delta_t, const Mapping mapping = DEROTATION) const;
+
+		//! Accessor to retrieve the size of the X axes of the destination
+		unsigned Xaxes() const
+		{return xAxes;}
+
+		//! Accessor to retrieve the size of the Y axes of the destination
+		unsigned Yaxes() const
+		{return yAxes;}
+
+		//! Accessor to retrieve the size of the X axes of the source
+		unsigned SourceXaxes() const
+		{return sourceXAxes;}
+
+		//! Accessor to retrieve the size of the Y axes of the source
+		unsigned SourceYaxes() const
+		{return sourceYAxes;}
+
+		//! Accessor to retrieve the index of the lower left source pixel of destination pixel j, or NO_SOURCE
+		unsigned sourceIndex(const unsigned j) const
+		{return indices[j];}
+
+		//! Accessor to retrieve the bilinear weight along x of destination pixel j
+		float xWeight(const unsigned j) const
+		{return xWeights[j];}
+
+		//! Accessor to retrieve the bilinear weight along y of destination pixel j
+		float yWeight(const unsigned j) const
+		{return yWeights[j];}
+
+		//! Accessor to retrieve the first column of row y that has a source
+		unsigned RowBegin(const unsigned y) const
+		{return rowBegin[y];}
+
+		//! Accessor to retrieve the last column + 1 of row y that has a source
+		unsigned RowEnd(const unsigned y) const
+		{return rowEnd[y];}
+
+		//! Routine that returns a table for those parameters, from the cache or newly built
+		/*! The table must be given back with release when it is not used anymore */
+		static const RemapTable* get(const WCS& destinationWCS, const unsigned xAxes, const unsigned yAxes, const WCS& sourceWCS, const unsigned sourceXAxes, const unsigned sourceYAxes, const int delta_t, const Mapping mapping = DEROTATION);
+
+		//! Routine to give back a table obtained with get
+		static void release(const RemapTable* table);
+
+		//! Routine to remove all unused tables from the cache
+		static void clearCache();
+};
+
+#endif
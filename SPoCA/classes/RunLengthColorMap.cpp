@@ -0,0 +1,213 @@
+#include "RunLengthColorMap.h"
+#include <algorithm>
+
+//!@file RunLengthColorMap.cpp
+
+using namespace std;
+
+//! Comparison of the end of a run with a column, to search the first run that ends after a column
+static bool runEndsBefore(const ColorRun& run, const unsigned x)
+{
+	return run.xEnd <= x;
+}
+
+RunLengthColorMap::RunLengthColorMap(const ColorMap* map)
+:xAxes(map->Xaxes()), yAxes(map->Yaxes()), nullpixelvalue(map->null()), wcs(map->getWCS()), rows(map->Yaxes() + 1, 0)
+{
+	for(unsigned y = 0; y < yAxes; ++y)
+	{
+		rows[y] = runs.size();
+		const ColorType* row = map->row(y);
+		unsigned x = 0;
+		while(x < xAxes)
+		{
+			const ColorType color = row[x];
+			unsigned xEnd = x + 1;
+			while(xEnd < xAxes && row[xEnd] == color)
+				++xEnd;
+			if(color != nullpixelvalue)
+				runs.push_back(ColorRun(x, xEnd, color));
+			x = xEnd;
+		}
+	}
+	rows[yAxes] = runs.size();
+}
+
+void RunLengthColorMap::toColorMap(ColorMap* map) const
+{
+	map->resize(xAxes, yAxes);
+	map->setNullValue(nullpixelvalue);
+	map->zero(nullpixelvalue);
+	for(unsigned y = 0; y < yAxes; ++y)
+	{
+		ColorType* row = map->row(y);
+		for(const ColorRun* r = rowBegin(y); r < rowEnd(y); ++r)
+			fill(row + r->xBegin, row + r->xEnd, r->color);
+	}
+}
+
+ColorType RunLengthColorMap::pixel(const unsigned x, const unsigned y) const
+{
+	if(x >= xAxes || y >= yAxes)
+		return nullpixelvalue;
+	const ColorRun* r = lower_bound(rowBegin(y), rowEnd(y), x, runEndsBefore);
+	if(r < rowEnd(y) && r->xBegin <= x)
+		return r->color;
+	else
+		return nullpixelvalue;
+}
+
+ColorType RunLengthColorMap::interpolate(float x, float y) const
+{
+	x = x < 0.? 0. : min(float(xAxes-1.001), x);
+	y = y < 0.? 0. : min(float(yAxes-1.001), y);
+
+	unsigned ix = (unsigned) x;
+	unsigned iy = (unsigned) y;
+	// The colors of the pixel, its right, upper and upper right neighbours, with one search of the runs per row
+	ColorType colors[4];
+	for(unsigned j = 0; j < 2; ++j)
+	{
+		const ColorRun* end = rowEnd(iy + j);
+		const ColorRun* r = lower_bound(rowBegin(iy + j), end, ix, runEndsBefore);
+		colors[2 * j] = r < end && r->xBegin <= ix ? r->color : nullpixelvalue;
+		if(r < end && r->xEnd <= ix + 1)
+			++r;
+		colors[2 * j + 1] = r < end && r->xBegin <= ix + 1 ? r->color : nullpixelvalue;
+	}
+	return majority(colors, 2, x - ix, y - iy);
+}
+
+void RunLengthColorMap::filterRuns(const set<ColorType>& colors, const bool keep)
+{
+	// The runs are moved in place, so the index of the first run of a row is only updated after it has been read
+	unsigned k = 0;
+	unsigned first = rows[0];
+	for(unsigned y = 0; y < yAxes; ++y)
+	{
+		const unsigned end = rows[y + 1];
+		rows[y] = k;
+		for(unsigned r = first; r < end; ++r)
+		{
+			if((colors.count(runs[r].color) != 0) == keep)
+			{
+				runs[k] = runs[r];
+				++k;
+			}
+		}
+		first = end;
+	}
+	rows[yAxes] = k;
+	runs.resize(k);
+}
+
+void RunLengthColorMap::eraseColors(const set<ColorType>& colors)
+{
+	filterRuns(colors, false);
+}
+
+void RunLengthColorMap::keepColors(const set<ColorType>& colors)
+{
+	filterRuns(colors, true);
+}
+
+unsigned RunLengthColorMap::area(const ColorType color) const
+{
+	unsigned numberPixels = 0;
+	for(vector<ColorRun>::const_iterator r = runs.begin(); r != runs.end(); ++r)
+		if(r->color == color)
+			numberPixels += r->length();
+	return numberPixels;
+}
+
+map<ColorType, unsigned> RunLengthColorMap::areas() const
+{
+	map<ColorType, unsigned> numberPixels;
+	for(vector<ColorRun>::const_iterator r = runs.begin(); r != runs.end(); ++r)
+		numberPixels[r->color] += r->length();
+	return numberPixels;
+}
+
+unsigned RunLengthColorMap::intersection(const ColorType color, const RunLengthColorMap* other, const ColorType otherColor, const unsigned beginRow, const unsigned endRow) const
+{
+	unsigned intersectPixels = 0;
+	const unsigned lastRow = min(endRow, min(yAxes, other->yAxes));
+	for(unsigned y = beginRow; y < lastRow; ++y)
+	{
+		// The runs of the 2 rows are sorted, so we walk them together
+		const ColorRun* r1 = rowBegin(y);
+		const ColorRun* r2 = other->rowBegin(y);
+		while(r1 < rowEnd(y) && r2 < other->rowEnd(y))
+		{
+			if(r1->color == color && r2->color == otherColor)
+			{
+				const unsigned xBegin = max(r1->xBegin, r2->xBegin);
+				const unsigned xEnd = min(r1->xEnd, r2->xEnd);
+				if(xBegin < xEnd)
+					intersectPixels += xEnd - xBegin;
+			}
+			if(r1->xEnd < r2->xEnd)
+				++r1;
+			else
+				++r2;
+		}
+	}
+	return intersectPixels;
+}
+
+void RunLengthColorMap::borderPixels(const unsigned y, const ColorRun* r, vector<bool>& atBorder) const
+{
+	const unsigned length = r->length();
+	// For each pixel, the number of neighbours above and below of the same color
+	vector<unsigned char> sameNeighbours(length, 0);
+	const unsigned neighbourRows[] = {y - 1, y + 1};
+	for(unsigned n = 0; n < 2; ++n)
+	{
+		const unsigned ny = neighbourRows[n];
+		if(ny >= yAxes)
+			continue;
+		for(const ColorRun* s = lower_bound(rowBegin(ny), rowEnd(ny), r->xBegin, runEndsBefore); s < rowEnd(ny) && s->xBegin < r->xEnd; ++s)
+		{
+			if(s->color != r->color)
+				continue;
+			const unsigned xBegin = max(s->xBegin, r->xBegin);
+			const unsigned xEnd = min(s->xEnd, r->xEnd);
+			for(unsigned x = xBegin; x < xEnd; ++x)
+				++sameNeighbours[x - r->xBegin];
+		}
+	}
+	// The first and the last pixel of a run have a left or right neighbour of a different color
+	atBorder.resize(length);
+	for(unsigned i = 0; i < length; ++i)
+		atBorder[i] = i == 0 || i + 1 == length || sameNeighbours[i] < 2;
+}
+
+RunLengthColorMap* RunLengthColorMap::drawInternContours()
+{
+	vector<ColorRun> contours;
+	vector<unsigned> contoursRows(yAxes + 1, 0);
+	vector<bool> atBorder;
+	for(unsigned y = 0; y < yAxes; ++y)
+	{
+		contoursRows[y] = contours.size();
+		for(const ColorRun* r = rowBegin(y); r < rowEnd(y); ++r)
+		{
+			borderPixels(y, r, atBorder);
+			for(unsigned i = 0; i < atBorder.size(); ++i)
+			{
+				if(! atBorder[i])
+					continue;
+				// The pixels at the border are gathered in runs
+				unsigned j = i + 1;
+				while(j < atBorder.size() && atBorder[j])
+					++j;
+				contours.push_back(ColorRun(r->xBegin + i, r->xBegin + j, r->color));
+				i = j;
+			}
+		}
+	}
+	contoursRows[yAxes] = contours.size();
+	runs.swap(contours);
+	rows.swap(contoursRows);
+	return this;
+}
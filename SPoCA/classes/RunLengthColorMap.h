@@ -0,0 +1,149 @@
+#pragma once
+#ifndef RunLengthColorMap_H
+#define RunLengthColorMap_H
+
+#include <vector>
+#include <map>
+#include <set>
+#include <limits>
+
+#include "constants.h"
+#include "Coordinate.h"
+#include "WCS.h"
+#include "ColorMap.h"
+
+//! Horizontal run of pixels [xBegin, xEnd) of the same color in a row of a map
+class ColorRun
+{
+	public :
+		//! First column of the run
+		unsigned xBegin;
+
+		//! Last column + 1 of the run
+		unsigned xEnd;
+
+		//! Color of the pixels of the run
+		ColorType color;
+
+		//! Constructor
+		ColorRun(const unsigned xBegin = 0, const unsigned xEnd = 0, const ColorType color = 0)
+		:xBegin(xBegin), xEnd(xEnd), color(color)
+		{}
+
+		//! Accessor to retrieve the number of pixels of the run
+		unsigned length() const
+		{return xEnd - xBegin;}
+};
+
+//! Class that stores a ColorMap as runs of pixels of the same color
+/*!
+Only the runs of non null pixels are stored, row by row and from left to right, so a map of a few regions
+takes a small fraction of the memory of the ColorMap, and the routines below only visit the runs.
+Two consecutive runs of a row always have a different color or are separated by null pixels.
+
+The pixels outside of the map are considered null. The WCS of the ColorMap is kept to compute the regions.
+*/
+
+class RunLengthColorMap
+{
+	private :
+		//! Size of the X axes of the map
+		unsigned xAxes;
+
+		//! Size of the Y axes of the map
+		unsigned yAxes;
+
+		//! Value of the null pixels
+		ColorType nullpixelvalue;
+
+		//! The WCS of the map
+		WCS wcs;
+
+		//! The runs of all the rows
+		std::vector<ColorRun> runs;
+
+		//! For each row, the index of its first run in runs, and the number of runs for the last one
+		std::vector<unsigned> rows;
+
+		//! Routine that removes the runs whose color is in colors if keep is false, or is not in colors if keep is true
+		void filterRuns(const std::set<ColorType>& colors, const bool keep);
+
+		//! Accessor to retrieve a pointer to the first run
+		const ColorRun* firstRun() const
+		{return runs.empty() ? NULL : &runs[0];}
+
+	public :
+		//! Constructor from a ColorMap
+		RunLengthColorMap(const ColorMap* map);
+
+		//! Routine that writes the pixels into a ColorMap
+		/*! The map is resized to the size of the runs, its header and WCS are not modified */
+		void toColorMap(ColorMap* map) const;
+
+		//! Accessor to retrieve the size of the X axes of the map
+		unsigned Xaxes() const
+		{return xAxes;}
+
+		//! Accessor to retrieve the size of the Y axes of the map
+		unsigned Yaxes() const
+		{return yAxes;}
+
+		//! Accessor to retrieve the null pixel value
+		ColorType null() const
+		{return nullpixelvalue;}
+
+		//! Accessor to retrieve the WCS
+		const WCS& getWCS() const
+		{return wcs;}
+
+		//! Accessor to retrieve the number of runs
+		unsigned NumberRuns() const
+		{return runs.size();}
+
+		//! Accessor to retrieve the first run of row y
+		const ColorRun* rowBegin(const unsigned y) const
+		{return firstRun() + rows[y];}
+
+		//! Accessor to retrieve the last run + 1 of row y
+		const ColorRun* rowEnd(const unsigned y) const
+		{return firstRun() + rows[y + 1];}
+
+		//! Accessor to retrieve the color of the pixel (x, y)
+		ColorType pixel(const unsigned x, const unsigned y) const;
+
+		//! Accessor to retrieve the color of the pixel c
+		ColorType pixel(const PixLoc& c) const
+		{return pixel(c.x, c.y);}
+
+		//! Accessor to retrieve the interpolated value of the map in x y, like ColorMap::interpolate
+		ColorType interpolate(float x, float y) const;
+
+		//! Accessor to retrieve the interpolated value of the map in c
+		ColorType interpolate(const RealPixLoc& c) const
+		{return interpolate(c.x, c.y);}
+
+		//! Routine that erase the colors provided
+		void eraseColors(const std::set<ColorType>& colors);
+
+		//! Routine that erase all but the colors provided
+		void keepColors(const std::set<ColorType>& colors);
+
+		//! Routine that returns the number of pixels of color
+		unsigned area(const ColorType color) const;
+
+		//! Routine that returns the number of pixels of each color
+		std::map<ColorType, unsigned> areas() const;
+
+		//! Routine that returns the number of pixels of color that have the color otherColor in the other map
+		/*! Only the rows [beginRow, endRow) are compared, the maps must have the same size */
+		unsigned intersection(const ColorType color, const RunLengthColorMap* other, const ColorType otherColor, const unsigned beginRow = 0, const unsigned endRow = std::numeric_limits<unsigned>::max()) const;
+
+		//! Routine that returns for each pixel of the run r of row y if it is at the border of its region
+		/*! A pixel is at the border if one of its 4 neighbours has a different color, like in getRegions */
+		void borderPixels(const unsigned y, const ColorRun* r, std::vector<bool>& atBorder) const;
+
+		//! Routine that keeps only the pixels at the border of the regions, i.e. the internal contours of width 1
+		RunLengthColorMap* drawInternContours();
+};
+
+#endif
@@ -1,12 +1,27 @@
 #include "STAFFStats.h"
+#include "StatsEngine.h"
 
 using namespace std;
 
 STAFFStats::STAFFStats(const time_t& observationTime, const unsigned id)
-:id(id),observationTime(observationTime), numberPixels(0), m2(NAN), m3(NAN), m4(NAN), minIntensity(NAN), maxIntensity(NAN), totalIntensity(0), area_Raw(0), area_AtDiskCenter(0), fillingFactor(0)
+:id(id),observationTime(observationTime), numberPixels(0), minIntensity(NAN), maxIntensity(NAN), totalIntensity(0), area_Raw(0), area_AtDiskCenter(0), fillingFactor(0)
 {}
 
 void STAFFStats::add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const Real& sun_radius)
+{
+	Real dx = fabs(coordinate.x - sunCenter.x);
+	Real dy = fabs(coordinate.y - sunCenter.y);
+	Real radius_squared = sun_radius * sun_radius;
+	Real sigma = radius_squared - (dx * dx) - (dy * dy);
+	
+	// We compute the contribution of the pixel to the raw area in Mm², and the correction factor to the area at disk center
+	const Real raw_pixel_area = (SUN_RADIUS) * (SUN_RADIUS) / radius_squared;
+	const Real area_correction_factor = sigma > 0 ? sun_radius/sqrt(sigma) : numeric_limits<Real>::infinity();
+	
+	add(pixelIntensity, raw_pixel_area, area_correction_factor);
+}
+
+void STAFFStats::add(const EUVPixelType& pixelIntensity, const Real raw_pixel_area, const Real area_correction_factor)
 {
 	// If the intensity is not a number we omit it
 	if(not (isnan(pixelIntensity) || isinf(pixelIntensity)))
@@ -19,34 +34,15 @@ void STAFFStats::add(const PixLoc& coordinate, const EUVPixelType& pixelIntensit
 		
 		totalIntensity += pixelIntensity;
 		
-		// We keep a vector of intensities to compute the variance, the skewness and the kurtosis
-		intensities.push_back(pixelIntensity);
-		
-		// If I add an intensity, the previously computed moment of order > 1 are invalid
-		m2 = NAN;
-		m3 = NAN;
-		m4 = NAN;
+		// We keep the distribution of intensities to compute the variance, the skewness, the kurtosis and the quantiles
+		intensities.add(pixelIntensity);
 	}
-
-	Real dx = fabs(coordinate.x - sunCenter.x);
-	Real dy = fabs(coordinate.y - sunCenter.y);
-	Real radius_squared = sun_radius * sun_radius;
-	Real sigma = radius_squared - (dx * dx) - (dy * dy);
 	
 	++numberPixels;
 	
-	// We compute the contribution of the pixel to the raw area in Mm²
-	const Real raw_pixel_area = (SUN_RADIUS) * (SUN_RADIUS) / radius_squared;
-	
+	// We add the contribution of the pixel to the raw area in Mm²
 	area_Raw += raw_pixel_area;
 	
-	// We compute the contribution of the pixel to the area at disk center in Mm²
-	Real area_correction_factor = HIGGINS_FACTOR + 1;
-	if(sigma > 0)
-	{
-		area_correction_factor = sun_radius/sqrt(sigma);
-	}
-
 	// If the area correction factor is more than some value (i.e. the pixel is near the limb)
 	if (area_correction_factor <= HIGGINS_FACTOR)
 	{
@@ -114,7 +110,7 @@ Real STAFFStats::Median() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.5);
+		return intensities.quantile(0.5);
 }
 
 Real STAFFStats::LowerQuartile() const
@@ -122,7 +118,7 @@ Real STAFFStats::LowerQuartile() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.25);
+		return intensities.quantile(0.25);
 }
 
 Real STAFFStats::UpperQuartile() const
@@ -130,38 +126,15 @@ Real STAFFStats::UpperQuartile() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.75);
+		return intensities.quantile(0.75);
 }
 
-void STAFFStats::computeMoments()
-{
-	Real mean = Mean();
-	if(isnan(mean) || isinf(mean))
-	{
-		m2 = m3 = m4 = NAN;
-	}
-	else
-	{
-		m2 = m3 = m4 = 0;
-		for (unsigned i = 0; i < intensities.size(); ++i)
-		{
-			Real delta = intensities[i] - mean;
-			Real delta2 = delta * delta;
-			m2 += delta2;
-			m4 += delta2 * delta2;
-			m3 += delta2 * delta;
-		}
-	}
-}
 Real STAFFStats::Variance() const
 {
 	if (intensities.size() == 0)
 		return NAN;
-	if(isnan(m2))
-	{
-		const_cast<STAFFStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2();
+	
 	if (isinf(m2) || isnan(m2))
 		return NAN;
 	else
@@ -173,11 +146,8 @@ Real STAFFStats::Skewness() const
 {
 	if (intensities.size() == 0)
 		return NAN;
-	if(isnan(m2) || isnan(m3))
-	{
-		const_cast<STAFFStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2(), m3 = intensities.M3();
+	
 	if (isinf(m3) || isnan(m3) || isinf(m2) || isnan(m2) || m2 <= 0)
 		return NAN;
 	else
@@ -189,11 +159,8 @@ Real STAFFStats::Kurtosis() const
 {
 	if(intensities.size() == 0)
 		return NAN;
-	if(isnan(m2) || isnan(m4))
-	{
-		const_cast<STAFFStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2(), m4 = intensities.M4();
+	
 	if (isinf(m4) || isnan(m4) || isinf(m2) || isnan(m2) || m2 <= 0)
 		return NAN;
 	else
@@ -276,31 +243,9 @@ vector<STAFFStats*> getSTAFFStats(const ColorMap* coloredMap, const EUVImage* im
 
 STAFFStats getSTAFFStats(const ColorMap* coloredMap, ColorType color, const EUVImage* image)
 {
-	STAFFStats stats(image->ObservationTime());
-	
-	RealPixLoc sunCenter = coloredMap->SunCenter();
-	Real sunRadius = coloredMap->SunRadius();
-	unsigned totalNonNullPixels = 0;
-	
-	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
-	{
-		for (unsigned x = 0; x < coloredMap->Xaxes(); ++x)
-		{
-			if(coloredMap->pixel(x,y) == color)
-			{
-				// We add the pixel to the region
-				stats.add(PixLoc(x,y), image->pixel(x, y), sunCenter, sunRadius);
-			}
-			
-			if(coloredMap->pixel(x,y)!= coloredMap->null())
-			{
-				++totalNonNullPixels;
-			}
-		}
-	}
-	// We correct the filling factor
-	stats.fillingFactor = Real(stats.NumberPixels())/ Real(totalNonNullPixels);
-	return stats;
+	StatsEngine engine(coloredMap, StatsEngine::STAFF_STATS);
+	engine.setSTAFFColor(color);
+	return engine.compute(image).staffStats[0];
 }
 
 vector<STAFFStats> getSTAFFStats(const ColorMap* CHMap, ColorType CHClass, const ColorMap* ARMap, ColorType ARClass, const EUVImage* image)
@@ -4,7 +4,6 @@
 
 #include <limits>
 #include <cmath>
-#include <deque>
 
 #include "constants.h"
 #include "tools.h"
@@ -13,6 +12,7 @@
 #include "ColorMap.h"
 #include "FitsFile.h"
 #include "Region.h"
+#include "IntensityDistribution.h"
 
 //! Class to obtain information about the statistics of a region for the STAFF
 /*!
@@ -32,14 +32,9 @@ class STAFFStats
 		time_t observationTime;
 		//! Total number of pixels in the class
 		unsigned numberPixels;
-		// Moments
-		mutable Real m2, m3, m4;
 		Real minIntensity, maxIntensity, totalIntensity, area_Raw, area_AtDiskCenter, fillingFactor;
-		mutable std::deque<EUVPixelType> intensities;
-
-	private :
-		//! Routine to compute the moments from the pixel intensities vector
-		void computeMoments();
+		//! The intensities of the pixels, to compute the moments and the quantiles
+		IntensityDistribution intensities;
 
 	public :
 		//! Constructor
@@ -92,8 +87,11 @@ class STAFFStats
 		//! Routine to update a class with a new pixel
 		void add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const Real& sun_radius);
 		
-		// We must make the getSTAFFStats functions as friends so they can correct the filling factor
-		friend STAFFStats getSTAFFStats(const ColorMap*, ColorType, const EUVImage*);
+		//! Routine to update a class with a new pixel, and the terms of the area of the pixel (see DeprojectedAreaMap)
+		void add(const EUVPixelType& pixelIntensity, const Real raw_pixel_area, const Real area_correction_factor);
+		
+		// We must make the StatsEngine and the getSTAFFStats functions friends so they can correct the filling factor
+		friend class StatsEngine;
 		friend std::vector<STAFFStats> getSTAFFStats(const ColorMap*, ColorType, const ColorMap*, ColorType, const EUVImage*);
 };
 
@@ -1,15 +1,29 @@
 #include "SegmentationStats.h"
+#include "StatsEngine.h"
 
 using namespace std;
 
 SegmentationStats::SegmentationStats(const time_t& observationTime, const unsigned id)
-:id(id),observationTime(observationTime), numberPixels(0), m2(NAN), m3(NAN), m4(NAN), minIntensity(NAN), maxIntensity(NAN), totalIntensity(0), area_Raw(0), area_AtDiskCenter(0), fillingFactor(0)
+:id(id),observationTime(observationTime), numberPixels(0), minIntensity(NAN), maxIntensity(NAN), totalIntensity(0), area_Raw(0), area_AtDiskCenter(0), fillingFactor(0)
 {}
 
 
 void SegmentationStats::add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const Real& sun_radius)
 {
+	Real dx = fabs(coordinate.x - sunCenter.x);
+	Real dy = fabs(coordinate.y - sunCenter.y);
+	Real radius_squared = sun_radius * sun_radius;
+	Real sigma = radius_squared - (dx * dx) - (dy * dy);
+	
+	// We compute the contribution of the pixel to the raw area in Mm², and the correction factor to the area at disk center
+	const Real raw_pixel_area = (SUN_RADIUS) * (SUN_RADIUS) / radius_squared;
+	const Real area_correction_factor = sigma > 0 ? sun_radius/sqrt(sigma) : numeric_limits<Real>::infinity();
+	
+	add(pixelIntensity, raw_pixel_area, area_correction_factor, 1./(PI*radius_squared));
+}
 
+void SegmentationStats::add(const EUVPixelType& pixelIntensity, const Real raw_pixel_area, const Real area_correction_factor, const Real pixel_filling_factor)
+{
 	// If the intensity is not a number, the event is said to be clipped spatially
 	if(not (isnan(pixelIntensity) || isinf(pixelIntensity)))
 	{
@@ -21,36 +35,19 @@ void SegmentationStats::add(const PixLoc& coordinate, const EUVPixelType& pixelI
 		
 		totalIntensity += pixelIntensity;
 		
-		// We keep a vector of intensities to compute the variance, the skewness and the kurtosis
-		intensities.push_back(pixelIntensity);
-		
-		// If I add an intensity, the previously computed moment of order > 1 are invalid
-		m2 = NAN;
-		m3 = NAN;
-		m4 = NAN;
+		// We keep the distribution of intensities to compute the variance, the skewness, the kurtosis and the quantiles
+		intensities.add(pixelIntensity);
 	}
 	
-	Real dx = fabs(coordinate.x - sunCenter.x);
-	Real dy = fabs(coordinate.y - sunCenter.y);
-	Real radius_squared = sun_radius * sun_radius;
-	Real sigma = radius_squared - (dx * dx) - (dy * dy);
-	
 	++numberPixels;
 	
-	// We compute the contribution of the pixel to the raw area in Mm², and it's uncertainity
-	const Real raw_pixel_area = (SUN_RADIUS) * (SUN_RADIUS) / radius_squared;
-	
+	// We add the contribution of the pixel to the raw area in Mm²
 	area_Raw += raw_pixel_area;
 	
-	// We compute the contribution of the pixel to the area at disk center in Mm², and it's uncertainity
-	Real area_correction_factor = HIGGINS_FACTOR + 1;
-	if(sigma > 0)
-	{
-		area_correction_factor = sun_radius/sqrt(sigma);
-		// We compute the filling factor
-		fillingFactor += 1./(PI*radius_squared);
-	}
-
+	// We compute the filling factor, for the pixels on the disc
+	if (! isinf(area_correction_factor))
+		fillingFactor += pixel_filling_factor;
+	
 	// If the area correction factor is more than some value (i.e. the pixel is near the limb)
 	if (area_correction_factor <= HIGGINS_FACTOR)
 	{
@@ -116,7 +113,7 @@ Real SegmentationStats::Median() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.5);
+		return intensities.quantile(0.5);
 }
 
 Real SegmentationStats::LowerQuartile() const
@@ -124,7 +121,7 @@ Real SegmentationStats::LowerQuartile() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.25);
+		return intensities.quantile(0.25);
 }
 
 Real SegmentationStats::UpperQuartile() const
@@ -132,38 +129,15 @@ Real SegmentationStats::UpperQuartile() const
 	if (intensities.size() == 0)
 		return NAN;
 	else
-		return quickselect(intensities, 0.75);
+		return intensities.quantile(0.75);
 }
 
-void SegmentationStats::computeMoments()
-{
-	Real mean = Mean();
-	if(isnan(mean) || isinf(mean))
-	{
-		m2 = m3 = m4 = NAN;
-	}
-	else
-	{
-		m2 = m3 = m4 = 0;
-		for (unsigned i = 0; i < intensities.size(); ++i)
-		{
-			Real delta = intensities[i] - mean;
-			Real delta2 = delta * delta;
-			m2 += delta2;
-			m4 += delta2 * delta2;
-			m3 += delta2 * delta;
-		}
-	}
-}
 Real SegmentationStats::Variance() const
 {
 	if (intensities.size() == 0)
 		return NAN;
-	if(isnan(m2))
-	{
-		const_cast<SegmentationStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2();
+	
 	if (isinf(m2) || isnan(m2))
 		return NAN;
 	else
@@ -175,11 +149,8 @@ Real SegmentationStats::Skewness() const
 {
 	if (intensities.size() == 0)
 		return NAN;
-	if(isnan(m2) || isnan(m3))
-	{
-		const_cast<SegmentationStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2(), m3 = intensities.M3();
+	
 	if (isinf(m3) || isnan(m3) || isinf(m2) || isnan(m2) || m2 <= 0)
 		return NAN;
 	else
@@ -191,11 +162,8 @@ Real SegmentationStats::Kurtosis() const
 {
 	if(intensities.size() == 0)
 		return NAN;
-	if(isnan(m2) || isnan(m4))
-	{
-		const_cast<SegmentationStats*>(this)->computeMoments();
-	}
-
+	const Real m2 = intensities.M2(), m4 = intensities.M4();
+	
 	if (isinf(m4) || isnan(m4) || isinf(m2) || isnan(m2) || m2 <= 0)
 		return NAN;
 	else
@@ -244,77 +212,15 @@ string SegmentationStats::toString(const string& separator, bool header) const
 
 vector<SegmentationStats*> getSegmentationStats(const ColorMap* coloredMap, const EUVImage* image, const set<ColorType>& classes)
 {
-	map<ColorType,SegmentationStats*> segmentation_stats;
-	for(set<ColorType>::iterator c=classes.begin(); c!=classes.end(); ++c)
-	{
-		segmentation_stats[*c] = new SegmentationStats(*c);
-	}
-	
-	RealPixLoc sunCenter = image->SunCenter();
-	Real sunRadius = image->SunRadius();
-	unsigned totalNonNullPixels = 0;
-	
-	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
-	{
-		for (unsigned x = 0; x < coloredMap->Xaxes(); ++x)
-		{
-			if(coloredMap->pixel(x,y) != coloredMap->null())
-			{
-				const ColorType& color = coloredMap->pixel(x,y);
-				
-				// We only compute the class stats for the given classes
-				if (segmentation_stats.count(color) > 0)
-				{
-					// We add the pixel to the class
-					segmentation_stats[color]->add(PixLoc(x,y), image->pixel(x, y), sunCenter, sunRadius);
-				}
-				
-				++totalNonNullPixels;
-			}
-		}
-	}
-	
-	// We correct the filling factors
-	for (std::map<ColorType,SegmentationStats*>::iterator it=segmentation_stats.begin(); it!=segmentation_stats.end(); ++it)
-		it->second->fillingFactor = Real(it->second->NumberPixels())/ Real(totalNonNullPixels);;
-
-	return values(segmentation_stats);
+	StatsEngine engine(coloredMap, StatsEngine::SEGMENTATION_STATS);
+	engine.setClasses(classes);
+	return engine.compute(image).segmentationStats;
 }
 
 vector<SegmentationStats*> getSegmentationStats(const ColorMap* coloredMap, const EUVImage* image)
 {
-	map<ColorType,SegmentationStats*> segmentation_stats;
-	
-	RealPixLoc sunCenter = image->SunCenter();
-	Real sunRadius = image->SunRadius();
-	unsigned totalNonNullPixels = 0;
-	
-	for (unsigned y = 0; y < coloredMap->Yaxes(); ++y)
-	{
-		for (unsigned x = 0; x < coloredMap->Xaxes(); ++x)
-		{
-			if(coloredMap->pixel(x,y) != coloredMap->null())
-			{
-				const ColorType& color = coloredMap->pixel(x,y);
-				
-				// If the segmentation_stats does not yet exist we create it
-				if (segmentation_stats.count(color) == 0)
-				{
-					segmentation_stats[color] = new SegmentationStats(image->ObservationTime(), color);
-				}
-				// We add the pixel to the class
-				segmentation_stats[color]->add(PixLoc(x,y), image->pixel(x, y), sunCenter, sunRadius);
-				
-				++totalNonNullPixels;
-			}
-		}
-	}
-	
-	// We correct the filling factors
-	for (std::map<ColorType,SegmentationStats*>::iterator it=segmentation_stats.begin(); it!=segmentation_stats.end(); ++it)
-		it->second->fillingFactor = Real(it->second->NumberPixels())/ Real(totalNonNullPixels);;
-	
-	return values(segmentation_stats);
+	StatsEngine engine(coloredMap, StatsEngine::SEGMENTATION_STATS);
+	return engine.compute(image).segmentationStats;
 }
 
 FitsFile& writeRegions(FitsFile& file, const vector<SegmentationStats*>& segmentation_stats)
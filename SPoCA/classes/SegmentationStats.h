@@ -4,7 +4,6 @@
 
 #include <limits>
 #include <cmath>
-#include <deque>
 #include <set>
 
 #include "constants.h"
@@ -13,6 +12,7 @@
 #include "EUVImage.h"
 #include "ColorMap.h"
 #include "FitsFile.h"
+#include "IntensityDistribution.h"
 
 //! Class to obtain information about the statistics of a class
 /*!
@@ -31,13 +31,9 @@ class SegmentationStats
 		time_t observationTime;
 		//! Total number of pixels in the class
 		unsigned numberPixels;
-		//! Moments
-		mutable Real m2, m3, m4;
 		Real minIntensity, maxIntensity, totalIntensity, area_Raw, area_AtDiskCenter, fillingFactor;
-		mutable std::deque<EUVPixelType> intensities;
-	private :
-		//! Routine to compute the moments from the pixel intensities vector
-		void computeMoments();
+		//! The intensities of the pixels, to compute the moments and the quantiles
+		IntensityDistribution intensities;
 
 	public :
 		//! Constructor
@@ -89,9 +85,12 @@ class SegmentationStats
 		//! Routine to update a class with a new pixel
 		void add(const PixLoc& coordinate, const EUVPixelType& pixelIntensity, const RealPixLoc& sunCenter, const Real& R);
 		
-		// We must make the getSTAFFStats functions as friends so they can correct the filling factor
-		friend std::vector<SegmentationStats*> getSegmentationStats(const ColorMap*, const EUVImage*);
-		friend std::vector<SegmentationStats*> getSegmentationStats(const ColorMap*, const EUVImage*, const std::set<ColorType>&);
+		//! Routine to update a class with a new pixel, and the terms of the area of the pixel (see DeprojectedAreaMap)
+		/*! pixel_filling_factor is the part of the disc covered by a pixel, it is only added if the pixel is on the disc */
+		void add(const EUVPixelType& pixelIntensity, const Real raw_pixel_area, const Real area_correction_factor, const Real pixel_filling_factor);
+		
+		// We must make the StatsEngine a friend so it can correct the filling factor
+		friend class StatsEngine;
 };
 
 //! Compute all statistics of an image using a ColorMap as a cache
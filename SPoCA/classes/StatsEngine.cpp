@@ -0,0 +1,347 @@
+#include "StatsEngine.h"
+#include "DeprojectedAreaMap.h"
+#include "ColorLUT.h"
+#include "parallel.h"
+#include <algorithm>
+
+//!@file StatsEngine.cpp
+
+using namespace std;
+
+StatsEngine::StatsEngine(const ColorMap* map, const unsigned families)
+:map(map), families(families), restrictRegions(false), restrictClasses(false), staffColor(0)
+{}
+
+void StatsEngine::setRegions(const vector<Region*>& regions)
+{
+	regionColors.clear();
+	regionIds.clear();
+	set<ColorType> colors;
+	for(unsigned r = 0; r < regions.size(); ++r)
+	{
+		// Like getRegionStats, the first region of a color gives its id to the stats
+		if(colors.insert(regions[r]->Color()).second)
+		{
+			regionColors.push_back(regions[r]->Color());
+			regionIds.push_back(regions[r]->Id());
+		}
+	}
+	restrictRegions = true;
+}
+
+void StatsEngine::setClasses(const set<ColorType>& classes)
+{
+	this->classes = classes;
+	restrictClasses = true;
+}
+
+void StatsEngine::setSTAFFColor(const ColorType color)
+{
+	staffColor = color;
+}
+
+//! Pixel of the map found by the StatsPixelsScanner
+struct StatsPixel
+{
+	unsigned x;
+	ColorType color;
+	bool atBorder;
+	//! The index + 1 of the stats of the pixel in the REGION_STATS, or 0
+	unsigned region;
+	//! The index + 1 of the stats of the pixel in the SEGMENTATION_STATS, or 0
+	unsigned segment;
+};
+
+//! Functor that finds the pixels to add to the stats in the rows [beginRow, endRow) of a map, with their border flag
+class StatsPixelsScanner
+{
+	private :
+		const ColorMap* map;
+		const bool nullPixels;
+		const bool borders;
+		const unsigned firstRow;
+		vector< vector<StatsPixel> >& pixels;
+	public :
+		StatsPixelsScanner(const ColorMap* map, const bool nullPixels, const bool borders, const unsigned firstRow, vector< vector<StatsPixel> >& pixels)
+		:map(map), nullPixels(nullPixels), borders(borders), firstRow(firstRow), pixels(pixels)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			const unsigned xAxes = map->Xaxes();
+			const unsigned yAxes = map->Yaxes();
+			const ColorType null = map->null();
+			StatsPixel pixel;
+			pixel.atBorder = false;
+			pixel.region = pixel.segment = 0;
+			for (unsigned r = beginRow; r < endRow; ++r)
+			{
+				const unsigned y = firstRow + r;
+				vector<StatsPixel>& rowPixels = pixels[r];
+				rowPixels.clear();
+				const ColorType* row = map->row(y);
+				// The pixels outside of the map are considered of a different color
+				const ColorType* previous = y > 0 ? row - xAxes : NULL;
+				const ColorType* next = y + 1 < yAxes ? row + xAxes : NULL;
+				for (unsigned x = 0; x < xAxes; ++x)
+				{
+					const ColorType color = row[x];
+					if(color == null && ! nullPixels)
+						continue;
+					pixel.x = x;
+					pixel.color = color;
+					// Is the pixel in the contour (<=> there is a neighboor pixel != pixel color)
+					if(borders && color != null)
+						pixel.atBorder = x == 0 || row[x-1] != color || x + 1 == xAxes || row[x+1] != color || ! previous || previous[x] != color || ! next || next[x] != color;
+					rowPixels.push_back(pixel);
+				}
+			}
+		}
+};
+
+//! The terms of the area of the pixels of an image
+struct ImageGeometry
+{
+	RealPixLoc sunCenter;
+	DeprojectedAreaMap* areaMap;
+	Real rawPixelArea;
+	Real rawPixelAreaUncert;
+	Real pixelFillingFactor;
+};
+
+//! Functor that adds the pixels found by the StatsPixelsScanner to the stats of the images [begin, end)
+class ImageStatsAccumulator
+{
+	private :
+		const vector<const EUVImage*>& images;
+		const vector<ImageGeometry>& geometries;
+		const ImageGeometry& mapGeometry;
+		const unsigned families;
+		const ColorType null;
+		const ColorType staffColor;
+		const unsigned firstRow;
+		const vector< vector<StatsPixel> >& pixels;
+		vector<ImageStats>& results;
+	public :
+		ImageStatsAccumulator(const vector<const EUVImage*>& images, const vector<ImageGeometry>& geometries, const ImageGeometry& mapGeometry, const unsigned families, const ColorType null, const ColorType staffColor, const unsigned firstRow, const vector< vector<StatsPixel> >& pixels, vector<ImageStats>& results)
+		:images(images), geometries(geometries), mapGeometry(mapGeometry), families(families), null(null), staffColor(staffColor), firstRow(firstRow), pixels(pixels), results(results)
+		{}
+		void operator()(const unsigned begin, const unsigned end)
+		{
+			for (unsigned i = begin; i < end; ++i)
+			{
+				const ImageGeometry& geometry = geometries[i];
+				ImageStats& stats = results[i];
+				for (unsigned r = 0; r < pixels.size(); ++r)
+				{
+					if(pixels[r].empty())
+						continue;
+					const unsigned y = firstRow + r;
+					const EUVPixelType* intensities = images[i]->row(y);
+					const Real* correctionFactors;
+					const Real* uncertainities;
+					geometry.areaMap->row(y, correctionFactors, uncertainities);
+					const Real* mapCorrectionFactors = NULL;
+					const Real* mapUncertainities = NULL;
+					if(families & StatsEngine::STAFF_STATS)
+						mapGeometry.areaMap->row(y, mapCorrectionFactors, mapUncertainities);
+
+					for (vector<StatsPixel>::const_iterator p = pixels[r].begin(); p != pixels[r].end(); ++p)
+					{
+						const EUVPixelType intensity = intensities[p->x];
+						if(p->region)
+							stats.regionStats[p->region - 1]->add(PixLoc(p->x,y), intensity, geometry.sunCenter, p->atBorder, geometry.rawPixelArea, geometry.rawPixelAreaUncert, correctionFactors[p->x], uncertainities[p->x]);
+						if(p->segment)
+							stats.segmentationStats[p->segment - 1]->add(intensity, geometry.rawPixelArea, correctionFactors[p->x], geometry.pixelFillingFactor);
+						if(families & StatsEngine::TOTAL_REGION_STATS)
+							stats.totalRegionStats[p->color != null ? 1 : 0]->add(intensity, geometry.rawPixelArea, correctionFactors[p->x], geometry.pixelFillingFactor);
+						if((families & StatsEngine::STAFF_STATS) && p->color == staffColor)
+							stats.staffStats[0].add(intensity, mapGeometry.rawPixelArea, mapCorrectionFactors[p->x]);
+					}
+				}
+			}
+		}
+};
+
+//! Routine that returns the terms of the area of the pixels of an image of size xAxes x yAxes
+/*! The map of the area must be given back with DeprojectedAreaMap::release */
+static ImageGeometry imageGeometry(const unsigned xAxes, const unsigned yAxes, const RealPixLoc& sunCenter, const Real sunRadius)
+{
+	ImageGeometry geometry;
+	geometry.sunCenter = sunCenter;
+	geometry.areaMap = DeprojectedAreaMap::get(xAxes, yAxes, sunCenter, sunRadius);
+	geometry.rawPixelArea = geometry.areaMap->RawPixelArea();
+	geometry.rawPixelAreaUncert = 2 * geometry.rawPixelArea * ((SUN_RADIUS_VARIATION / SUN_RADIUS) + (SUN_RADIUS_VARIATION_PIXELS / sunRadius));
+	geometry.pixelFillingFactor = 1./(PI*(sunRadius*sunRadius));
+	return geometry;
+}
+
+//! Comparison of the colors of 2 stats, by their index in a vector of colors
+class IndexColorLess
+{
+	private :
+		const vector<ColorType>& colors;
+	public :
+		IndexColorLess(const vector<ColorType>& colors)
+		:colors(colors)
+		{}
+		bool operator()(const unsigned a, const unsigned b) const
+		{
+			return colors[a] < colors[b];
+		}
+};
+
+//! Routine that sorts the stats by the order of their colors
+template<class Stats>
+static void sortByColor(vector<Stats*>& stats, const vector<ColorType>& colors)
+{
+	vector<unsigned> order(colors.size());
+	for(unsigned s = 0; s < order.size(); ++s)
+		order[s] = s;
+	sort(order.begin(), order.end(), IndexColorLess(colors));
+	vector<Stats*> sorted(order.size());
+	for(unsigned s = 0; s < order.size(); ++s)
+		sorted[s] = stats[order[s]];
+	stats.swap(sorted);
+}
+
+vector<ImageStats> StatsEngine::compute(const vector<const EUVImage*>& images) const
+{
+	const unsigned xAxes = map->Xaxes();
+	const unsigned yAxes = map->Yaxes();
+	const ColorType null = map->null();
+
+	vector<ImageStats> results(images.size());
+
+	for (unsigned i = 0; i < images.size(); ++i)
+	{
+		if(images[i]->Xaxes() != xAxes || images[i]->Yaxes() != yAxes)
+		{
+			cerr<<"Error : The image "<<images[i]->Label()<<" does not have the size of the map."<<endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// The maps of the area of the pixels are held until the end, so they stay valid whatever the number of geometries
+	vector<ImageGeometry> geometries(images.size());
+	for (unsigned i = 0; i < images.size(); ++i)
+		geometries[i] = imageGeometry(xAxes, yAxes, images[i]->SunCenter(), images[i]->SunRadius());
+	ImageGeometry mapGeometry;
+	mapGeometry.areaMap = NULL;
+	if(families & STAFF_STATS)
+		mapGeometry = imageGeometry(xAxes, yAxes, map->SunCenter(), map->SunRadius());
+
+	// For each color, the index + 1 of its stats
+	ColorLUT regionIndex(0), segmentIndex(0);
+	vector<ColorType> regionStatsColors, segmentStatsColors;
+
+	// We create the stats that do not depend on the colors of the map
+	for (unsigned i = 0; i < images.size(); ++i)
+	{
+		const time_t observationTime = images[i]->ObservationTime();
+		if(families & TOTAL_REGION_STATS)
+		{
+			results[i].totalRegionStats.push_back(new SegmentationStats(observationTime, 0));
+			results[i].totalRegionStats.push_back(new SegmentationStats(observationTime, 1));
+		}
+		if(families & STAFF_STATS)
+			results[i].staffStats.push_back(STAFFStats(observationTime));
+		if((families & REGION_STATS) && restrictRegions)
+		{
+			for(unsigned r = 0; r < regionColors.size(); ++r)
+				results[i].regionStats.push_back(new RegionStats(observationTime, regionIds[r]));
+		}
+		if((families & SEGMENTATION_STATS) && restrictClasses)
+		{
+			for(set<ColorType>::const_iterator c = classes.begin(); c != classes.end(); ++c)
+				results[i].segmentationStats.push_back(new SegmentationStats(observationTime, *c));
+		}
+	}
+	if((families & REGION_STATS) && restrictRegions)
+	{
+		regionStatsColors = regionColors;
+		for(unsigned r = 0; r < regionColors.size(); ++r)
+			regionIndex.set(regionColors[r], r + 1);
+	}
+	if((families & SEGMENTATION_STATS) && restrictClasses)
+	{
+		segmentStatsColors.assign(classes.begin(), classes.end());
+		for(unsigned c = 0; c < segmentStatsColors.size(); ++c)
+			segmentIndex.set(segmentStatsColors[c], c + 1);
+	}
+
+	unsigned totalNonNullPixels = 0;
+
+	// The map is scanned by blocks of rows, so that the pixels of a block can be kept in memory
+	const unsigned blockRows = 64 * numberThreads();
+	vector< vector<StatsPixel> > pixels(blockRows);
+	for (unsigned firstRow = 0; firstRow < yAxes; firstRow += blockRows)
+	{
+		const unsigned numberRows = firstRow + blockRows < yAxes ? blockRows : yAxes - firstRow;
+		pixels.resize(numberRows);
+		StatsPixelsScanner scanner(map, families & TOTAL_REGION_STATS, families & REGION_STATS, firstRow, pixels);
+		parallel_for_rows(numberRows, scanner);
+
+		// We find the stats of the pixels, in the order of the map so that the stats are created in the same order than in getRegionStats
+		for (unsigned r = 0; r < numberRows; ++r)
+		{
+			for (vector<StatsPixel>::iterator p = pixels[r].begin(); p != pixels[r].end(); ++p)
+			{
+				if(p->color == null)
+					continue;
+				++totalNonNullPixels;
+				if(families & REGION_STATS)
+				{
+					p->region = regionIndex(p->color);
+					if(p->region == 0 && ! restrictRegions)
+					{
+						for (unsigned i = 0; i < images.size(); ++i)
+							results[i].regionStats.push_back(new RegionStats(images[i]->ObservationTime(), regionStatsColors.size()));
+						regionStatsColors.push_back(p->color);
+						p->region = regionStatsColors.size();
+						regionIndex.set(p->color, p->region);
+					}
+				}
+				if(families & SEGMENTATION_STATS)
+				{
+					p->segment = segmentIndex(p->color);
+					if(p->segment == 0 && ! restrictClasses)
+					{
+						for (unsigned i = 0; i < images.size(); ++i)
+							results[i].segmentationStats.push_back(new SegmentationStats(images[i]->ObservationTime(), p->color));
+						segmentStatsColors.push_back(p->color);
+						p->segment = segmentStatsColors.size();
+						segmentIndex.set(p->color, p->segment);
+					}
+				}
+			}
+		}
+
+		// We add the pixels to the stats of the images, each image by a thread
+		ImageStatsAccumulator accumulator(images, geometries, mapGeometry, families, null, staffColor, firstRow, pixels, results);
+		parallel_for(images.size(), accumulator);
+	}
+
+	for (unsigned i = 0; i < images.size(); ++i)
+	{
+		// We correct the filling factors
+		for (unsigned s = 0; s < results[i].segmentationStats.size(); ++s)
+			results[i].segmentationStats[s]->fillingFactor = Real(results[i].segmentationStats[s]->NumberPixels())/ Real(totalNonNullPixels);
+		if(families & STAFF_STATS)
+			results[i].staffStats[0].fillingFactor = Real(results[i].staffStats[0].NumberPixels())/ Real(totalNonNullPixels);
+
+		// The stats are returned by order of color
+		sortByColor(results[i].regionStats, regionStatsColors);
+		sortByColor(results[i].segmentationStats, segmentStatsColors);
+	}
+
+	for (unsigned i = 0; i < images.size(); ++i)
+		DeprojectedAreaMap::release(geometries[i].areaMap);
+	DeprojectedAreaMap::release(mapGeometry.areaMap);
+
+	return results;
+}
+
+ImageStats StatsEngine::compute(const EUVImage* image) const
+{
+	return compute(vector<const EUVImage*>(1, image))[0];
+}
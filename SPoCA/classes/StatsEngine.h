@@ -0,0 +1,90 @@
+#pragma once
+#ifndef StatsEngine_H
+#define StatsEngine_H
+
+#include <vector>
+#include <set>
+
+#include "constants.h"
+#include "EUVImage.h"
+#include "ColorMap.h"
+#include "Region.h"
+#include "RegionStats.h"
+#include "SegmentationStats.h"
+#include "STAFFStats.h"
+
+//! The statistics of the regions of a map computed by a StatsEngine on one image
+/*! The stats are allocated with new, and must be deleted by the caller */
+class ImageStats
+{
+	public :
+		//! The stats of each region, by order of color (see getRegionStats)
+		std::vector<RegionStats*> regionStats;
+
+		//! The stats of each class, by order of color (see getSegmentationStats)
+		std::vector<SegmentationStats*> segmentationStats;
+
+		//! The stats of the complement of the regions and of all the regions taken together (see getTotalRegionStats)
+		std::vector<SegmentationStats*> totalRegionStats;
+
+		//! The STAFF stats of the STAFF color (see getSTAFFStats)
+		std::vector<STAFFStats> staffStats;
+};
+
+//! Class that computes several families of statistics of the regions of a ColorMap on several images, in a single scan of the map
+/*!
+The map is scanned once, by blocks of rows in parallel, to find the color and the border flag of the pixels.
+The area of the pixels on the solar sphere comes from the DeprojectedAreaMap of the image geometry, so it is shared by all the families.
+The pixels of a block are then added to the stats of each image, the images in parallel, but the pixels of an image in the order of the map,
+so that the stats are identical to the ones computed by getRegionStats, getSegmentationStats, getTotalRegionStats and getSTAFFStats.
+
+The images must have the same size than the map.
+*/
+
+class StatsEngine
+{
+	public :
+		//! The families of statistics that can be requested
+		enum Family {REGION_STATS = 1, SEGMENTATION_STATS = 2, TOTAL_REGION_STATS = 4, STAFF_STATS = 8};
+
+	private :
+		//! The map of the regions
+		const ColorMap* map;
+
+		//! The requested families, an or of Family
+		unsigned families;
+
+		//! The colors and ids of the regions for the REGION_STATS, if they were given
+		std::vector<ColorType> regionColors;
+		std::vector<unsigned> regionIds;
+		bool restrictRegions;
+
+		//! The classes for the SEGMENTATION_STATS, if they were given
+		std::set<ColorType> classes;
+		bool restrictClasses;
+
+		//! The color for the STAFF_STATS
+		ColorType staffColor;
+
+	public :
+		//! Constructor
+		/*! @param families An or of the Family of the statistics to compute */
+		StatsEngine(const ColorMap* map, const unsigned families);
+
+		//! Routine to restrict the REGION_STATS to the regions provided, the stats take the id of the regions
+		void setRegions(const std::vector<Region*>& regions);
+
+		//! Routine to restrict the SEGMENTATION_STATS to the classes provided
+		void setClasses(const std::set<ColorType>& classes);
+
+		//! Routine to set the color of the STAFF_STATS
+		void setSTAFFColor(const ColorType color);
+
+		//! Routine that computes the requested statistics of the map on each image
+		std::vector<ImageStats> compute(const std::vector<const EUVImage*>& images) const;
+
+		//! Routine that computes the requested statistics of the map on an image
+		ImageStats compute(const EUVImage* image) const;
+};
+
+#endif
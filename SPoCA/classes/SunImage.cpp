@@ -3,7 +3,9 @@
 #include <limits>
 #include <cmath>
 #include <assert.h>
+#include <algorithm>
 #include "SunImage.h"
+#include "RemapTable.h"
 
 using namespace std;
 
@@ -65,6 +67,12 @@ inline WCS& SunImage<T>::getWCS()
 	return wcs;
 }
 
+template<class T>
+inline const WCS& SunImage<T>::getWCS() const
+{
+	return wcs;
+}
+
 template<class T>
 inline RealPixLoc SunImage<T>::SunCenter() const
 {
@@ -125,23 +133,21 @@ inline string SunImage<T>::Label() const
 		return Instrument() + " " + ObservationDate();
 }
 
+template<class T>
+inline DiscMask SunImage<T>::discMask(const Real radiusRatio) const
+{
+	return DiscMask(this->xAxes, this->yAxes, wcs.sun_center, radiusRatio * wcs.sun_radius);
+}
+
 template<class T>
 inline void SunImage<T>::nullifyAboveRadius(const Real radiusRatio)
 {
-	Real radius2 = radiusRatio*radiusRatio*wcs.sun_radius*wcs.sun_radius;
-	Real max_x = -wcs.sun_center.x + this->xAxes;
-	Real max_y = -wcs.sun_center.y + this->yAxes;
-	T* pixel_value = this->pixels;
-	
-	for (Real y = -wcs.sun_center.y; y < max_y; ++y)
+	const DiscMask mask = discMask(radiusRatio);
+	for (unsigned y = 0; y < this->yAxes; ++y)
 	{
-		for (Real x = -wcs.sun_center.x; x < max_x; ++x)
-		{
-			if (x * x + y * y > radius2)
-				*pixel_value = this->nullpixelvalue;
-			
-			++pixel_value;
-		}
+		T* row = this->row(y);
+		fill(row, row + mask.RowBegin(y), this->nullpixelvalue);
+		fill(row + mask.RowEnd(y), row + this->xAxes, this->nullpixelvalue);
 	}
 }
 
@@ -189,25 +195,15 @@ inline void SunImage<T>::recenter(const RealPixLoc& newCenter)
 template<class T>
 inline void SunImage<T>::rotate(const int delta_t)
 {
-	// We make a copy of the original image
-	Image<T> original(this);
+	// We move the pixels to a temporary image, and take new pixels for the result
+	Image<T> original;
+	original.swapPixels(*this);
+	this->resize(original.Xaxes(), original.Yaxes());
 	
-	//We compute for each pixel in the new image what is the original location
-	RealPixLoc new_location;
-	T* new_value = this->pixels;
-	for(new_location.y = 0;  new_location.y < this->yAxes; ++new_location.y)
-	{
-		for(new_location.x = 0; new_location.x < this->xAxes; ++new_location.x)
-		{
-			RealPixLoc original_location = rotate(new_location, delta_t);
-			if(!original_location)
-				*new_value = this->nullpixelvalue;
-			else
-				*new_value = original.interpolate(original_location);
-			
-			++new_value;
-		}
-	}
+	// The remap table gives for each pixel in the new image what is the original location
+	const RemapTable* table = RemapTable::get(wcs, this->xAxes, this->yAxes, wcs, this->xAxes, this->yAxes, delta_t);
+	original.remap(table, this);
+	RemapTable::release(table);
 }
 
 
@@ -216,22 +212,11 @@ inline SunImage<T>* SunImage<T>::shifted_like(const SunImage* img) const
 {
 	SunImage<T>* shifted_image = new SunImage<T>(img->wcs, img->xAxes, img->yAxes);
 	
-	//We compute for each pixel in the rotated image what is the original location
-	RealPixLoc shifted_location;
-	T* shifted_value = shifted_image->pixels;
-	for(shifted_location.y = 0;  shifted_location.y < shifted_image->yAxes; ++shifted_location.y)
-	{
-		for(shifted_location.x = 0; shifted_location.x < shifted_image->xAxes; ++shifted_location.x)
-		{
-			RealPixLoc original_location = shifted_image->shift_like(shifted_location, this);
-			if(!original_location)
-				*shifted_value = shifted_image->null();
-			else
-				*shifted_value = Image<T>::interpolate(original_location);
-			
-			++shifted_value;
-		}
-	}
+	// The remap table gives for each pixel in the rotated image what is the original location
+	int delta_t = int(difftime(ObservationTime(), shifted_image->ObservationTime()));
+	const RemapTable* table = RemapTable::get(shifted_image->wcs, shifted_image->xAxes, shifted_image->yAxes, wcs, this->xAxes, this->yAxes, delta_t);
+	Image<T>::remap(table, shifted_image);
+	RemapTable::release(table);
 	return shifted_image;
 
 }
@@ -240,25 +225,16 @@ inline SunImage<T>* SunImage<T>::shifted_like(const SunImage* img) const
 template<class T>
 inline void SunImage<T>::shift_like(const SunImage* img)
 {
-	// We make a copy of the original image
-	Image<T> original(this);
+	// We move the pixels to a temporary image, and take new pixels for the result
+	Image<T> original;
+	original.swapPixels(*this);
+	this->resize(original.Xaxes(), original.Yaxes());
 	
-	//We compute for each pixel in the new image what is the original location
-	RealPixLoc new_location;
-	T* new_value = this->pixels;
-	for(new_location.y = 0;  new_location.y < this->yAxes; ++new_location.y)
-	{
-		for(new_location.x = 0; new_location.x < this->xAxes; ++new_location.x)
-		{
-			RealPixLoc original_location = img->shift_like(new_location, this);
-			if(!original_location)
-				*new_value = this->nullpixelvalue;
-			else
-				*new_value = original.interpolate(original_location);
-			
-			++new_value;
-		}
-	}
+	// The remap table gives for each pixel in the new image what is the original location
+	int delta_t = int(difftime(ObservationTime(), img->ObservationTime()));
+	const RemapTable* table = RemapTable::get(img->wcs, this->xAxes, this->yAxes, wcs, this->xAxes, this->yAxes, delta_t);
+	original.remap(table, this);
+	RemapTable::release(table);
 	wcs = img->wcs;
 }
 
@@ -433,6 +409,137 @@ inline HPC SunImage<T>::toHPC(const HGS& hgs) const
 	return toHPC(toHCC(hgs));
 }
 
+//! Number of coordinates converted at a time by the routines on spans
+static const unsigned SPAN_BLOCK_SIZE = 256;
+
+//! Routine that converts in place number Helioprojective cartesian coordinates to Heliocentric cartesian
+/*! Uses the same formulas as SunImage::toHCC(const HPC&), the sine and cosine of the y coordinate are only recomputed when it changes */
+static void spanHPCtoHCC(const WCS& wcs, const unsigned number, Real* x, Real* y, Real* z)
+{
+	const double dsun_squared = wcs.dsun_obs * wcs.dsun_obs;
+	const double sunradius_squared = wcs.sunradius_Mm * wcs.sunradius_Mm;
+	double last_hpc_y = NAN, cosy = NAN, siny = NAN;
+	for(unsigned i = 0; i < number; ++i)
+	{
+		double hpc_x = x[i] * ARCSEC2RADIAN;
+		double hpc_y = y[i] * ARCSEC2RADIAN;
+		if(hpc_y != last_hpc_y)
+		{
+			cosy = cos(hpc_y);
+			siny = sin(hpc_y);
+			last_hpc_y = hpc_y;
+		}
+		double cosx = cos(hpc_x);
+		double sinx = sin(hpc_x);
+		// We compute the dist between the sun observer and the surface of the sun
+		double q =  wcs.dsun_obs * cosy * cosx;
+		double dist = (q*q) - dsun_squared + sunradius_squared;
+		if (dist >= 0)
+		{
+			dist = q - sqrt(dist);
+			x[i] = dist * cosy * sinx;
+			y[i] = dist * siny;
+			z[i] = wcs.dsun_obs - (dist * cosy * cosx);
+		}
+		else
+		{
+			x[i] = y[i] = z[i] = numeric_limits<Real>::infinity();
+		}
+	}
+}
+
+//! Routine that converts number Heliocentric cartesian coordinates to Heliographic Stonyhurst
+/*! Uses the same formulas as SunImage::toHGS(const HCC&) */
+static void spanHCCtoHGS(const WCS& wcs, const unsigned number, const Real* x, const Real* y, const Real* z, Real* longitude, Real* latitude)
+{
+	for(unsigned i = 0; i < number; ++i)
+	{
+		if(!(isfinite(x[i]) && isfinite(y[i])))
+		{
+			longitude[i] = latitude[i] = numeric_limits<Real>::infinity();
+		}
+		else
+		{
+			latitude[i] = MIPI;
+			if((y[i] * wcs.cos_b0 + z[i] * wcs.sin_b0)/wcs.sunradius_Mm < 1)
+				latitude[i] = asin((y[i] * wcs.cos_b0 + z[i] * wcs.sin_b0)/wcs.sunradius_Mm);
+			longitude[i] = atan2(x[i], z[i] * wcs.cos_b0 - y[i] * wcs.sin_b0) + wcs.l0;
+		}
+	}
+}
+
+template<class T>
+void SunImage<T>::toHPC(const unsigned y, const unsigned xBegin, const unsigned xEnd, Real* hpc_x, Real* hpc_y) const
+{
+	// The contribution of the row is the same for all pixels
+	const Real ry = Real(y) - wcs.sun_center.y;
+	const Real row_x = ry * wcs.cd[0][1];
+	const Real row_y = ry * wcs.cd[1][1];
+	const Real cd00 = wcs.cd[0][0];
+	const Real cd10 = wcs.cd[1][0];
+	const Real center_x = wcs.sun_center.x;
+	for(unsigned x = xBegin, i = 0; x < xEnd; ++x, ++i)
+	{
+		Real rx = Real(x) - center_x;
+		hpc_x[i] = rx * cd00 + row_x;
+		hpc_y[i] = rx * cd10 + row_y;
+	}
+}
+
+template<class T>
+void SunImage<T>::toHCC(const unsigned y, const unsigned xBegin, const unsigned xEnd, Real* hcc_x, Real* hcc_y, Real* hcc_z) const
+{
+	toHPC(y, xBegin, xEnd, hcc_x, hcc_y);
+	spanHPCtoHCC(wcs, xEnd - xBegin, hcc_x, hcc_y, hcc_z);
+}
+
+template<class T>
+void SunImage<T>::toHGS(const unsigned y, const unsigned xBegin, const unsigned xEnd, Real* longitude, Real* latitude) const
+{
+	Real hcc_x[SPAN_BLOCK_SIZE], hcc_y[SPAN_BLOCK_SIZE], hcc_z[SPAN_BLOCK_SIZE];
+	for(unsigned begin = xBegin; begin < xEnd; begin += SPAN_BLOCK_SIZE)
+	{
+		const unsigned end = min(begin + SPAN_BLOCK_SIZE, xEnd);
+		toHCC(y, begin, end, hcc_x, hcc_y, hcc_z);
+		spanHCCtoHGS(wcs, end - begin, hcc_x, hcc_y, hcc_z, longitude + (begin - xBegin), latitude + (begin - xBegin));
+	}
+}
+
+template<class T>
+void SunImage<T>::toRealPixLoc(const unsigned number, const Real* longitude, const Real* latitude, Real* x, Real* y) const
+{
+	const Real infinity = numeric_limits<Real>::infinity();
+	Real last_latitude = NAN, cos_latitude = NAN, sin_latitude = NAN;
+	for(unsigned i = 0; i < number; ++i)
+	{
+		// We use the same formulas as toHCC(const HGS&), toHPC(const HCC&) and toRealPixLoc(const HPC&)
+		Real hpc_x = infinity, hpc_y = infinity;
+		if(isfinite(latitude[i]) && isfinite(longitude[i]))
+		{
+			if(latitude[i] != last_latitude)
+			{
+				cos_latitude = cos(latitude[i]);
+				sin_latitude = sin(latitude[i]);
+				last_latitude = latitude[i];
+			}
+			Real cos_longitude = cos(longitude[i] - wcs.l0);
+			Real sin_longitude = sin(longitude[i] - wcs.l0);
+			Real hcc_x = wcs.sunradius_Mm * cos_latitude * sin_longitude;
+			Real hcc_y = wcs.sunradius_Mm * (sin_latitude * wcs.cos_b0 - cos_latitude * cos_longitude * wcs.sin_b0);
+			Real hcc_z = wcs.sunradius_Mm * (sin_latitude * wcs.sin_b0 + cos_latitude * cos_longitude * wcs.cos_b0);
+			if(isfinite(hcc_x) && isfinite(hcc_y))
+			{
+				double zeta =  wcs.dsun_obs - hcc_z;
+				double dist = sqrt(hcc_x * hcc_x + hcc_y * hcc_y + zeta * zeta);
+				hpc_x = atan2(double(hcc_x), zeta) * RADIAN2ARCSEC;
+				hpc_y = asin(double(hcc_y) / dist) * RADIAN2ARCSEC;
+			}
+		}
+		x[i] = hpc_x * wcs.icd[0][0] + hpc_y * wcs.icd[0][1] + wcs.sun_center.x;
+		y[i] = hpc_x * wcs.icd[1][0] + hpc_y * wcs.icd[1][1] + wcs.sun_center.y;
+	}
+}
+
 template<class T>
 inline T SunImage<T>::interpolate(const HGS& c) const
 {
@@ -473,10 +580,15 @@ inline Real SunImage<T>::RealPixelArea(const RealPixLoc& c) const
 template<class T>
 inline vector<HGS> SunImage<T>::HGSmap() const
 {
-	vector<HPC> hpc = HPCmap();
-	vector<HGS> map(hpc.size(), HGS::null());
-	for(unsigned m = 0; m < hpc.size(); ++m)
-		map[m] = toHGS(hpc[m]);
+	vector<HGS> map(this->numberPixels, HGS::null());
+	vector<Real> longitude(this->xAxes), latitude(this->xAxes);
+	unsigned j = 0;
+	for(unsigned y = 0; y < this->yAxes; ++y)
+	{
+		toHGS(y, 0, this->xAxes, &(longitude[0]), &(latitude[0]));
+		for(unsigned x = 0; x < this->xAxes; ++x, ++j)
+			map[j] = HGS(longitude[x], latitude[x]);
+	}
 	return map;
 }
 
@@ -485,14 +597,13 @@ template<class T>
 inline vector<HPC> SunImage<T>::HPCmap() const
 {
 	vector<HPC> map(this->numberPixels);
+	vector<Real> hpc_x(this->xAxes), hpc_y(this->xAxes);
 	unsigned j = 0;
-	for(Real y = 0; y < this->yAxes; ++y)
+	for(unsigned y = 0; y < this->yAxes; ++y)
 	{
-		for(Real x = 0; x < this->xAxes; ++x)
-		{
-			map[j] = toHPC(RealPixLoc(x, y));
-			++j;
-		}
+		toHPC(y, 0, this->xAxes, &(hpc_x[0]), &(hpc_y[0]));
+		for(unsigned x = 0; x < this->xAxes; ++x, ++j)
+			map[j] = HPC(hpc_x[x], hpc_y[x]);
 	}
 	return map;
 }
@@ -500,10 +611,15 @@ inline vector<HPC> SunImage<T>::HPCmap() const
 template<class T>
 inline vector<HCC> SunImage<T>::HCCmap() const
 {
-	vector<HPC> hpc = HPCmap();
-	vector<HCC> map(hpc.size(), HCC::null());
-	for(unsigned m = 0; m < hpc.size(); ++m)
-		map[m] = toHCC(hpc[m]);
+	vector<HCC> map(this->numberPixels, HCC::null());
+	vector<Real> hcc_x(this->xAxes), hcc_y(this->xAxes), hcc_z(this->xAxes);
+	unsigned j = 0;
+	for(unsigned y = 0; y < this->yAxes; ++y)
+	{
+		toHCC(y, 0, this->xAxes, &(hcc_x[0]), &(hcc_y[0]), &(hcc_z[0]));
+		for(unsigned x = 0; x < this->xAxes; ++x, ++j)
+			map[j] = HCC(hcc_x[x], hcc_y[x], hcc_z[x]);
+	}
 	return map;
 }
 
@@ -650,41 +766,33 @@ bool SunImage<T>::readFits(const std::string& filename)
 template<class T>
 void SunImage<T>::equirectangular_projection(const SunImage<T>* image, bool exact)
 {
-	this->zero(this->null());
 	T* j = this->pixels;
 	
 	Real dy = PI / Real(this->yAxes), dx = PI / Real(this->xAxes);
 	
 	if(exact)
 	{
+		this->zero(this->null());
+		vector<Real> longitude(this->xAxes), latitude(this->xAxes), ix(this->xAxes), iy(this->xAxes);
+		for(unsigned px = 0; px < this->xAxes; ++px)
+			longitude[px] = (px * dx) - MIPI;
 		for(unsigned py = 0; py < this->yAxes; ++py)
 		{
-			Real latitude = (py * dy) - MIPI;
+			fill(latitude.begin(), latitude.end(), (py * dy) - MIPI);
+			image->toRealPixLoc(this->xAxes, &(longitude[0]), &(latitude[0]), &(ix[0]), &(iy[0]));
 			for(unsigned px = 0; px < this->xAxes; ++px)
 			{
-				Real longitude = (px * dx) - MIPI;
-				*j = image->interpolate(HGS(longitude, latitude));
+				*j = image->interpolate(ix[px], iy[px]);
 				++j;
 			}
 		}
 	}
 	else
 	{
-		Real sun_radius = image->SunRadius();
-		RealPixLoc sun_center = image->SunCenter();
-		for(unsigned py = 0; py < this->yAxes; ++py)
-		{
-			Real latitude = (py * dy) - MIPI;
-			Real cos_lat = cos(latitude);
-			Real iy = sun_center.y + (sin(latitude) * sun_radius);
-			for(unsigned px = 0; px < this->xAxes; ++px)
-			{
-				Real longitude = (px * dx) - MIPI;
-				Real ix = sun_center.x + (sun_radius * cos_lat * sin(longitude));
-				*j = image->interpolate(ix, iy);
-				++j;
-			}
-		}
+		// The location of each pixel in the image is given by a remap table
+		const RemapTable* table = RemapTable::get(wcs, this->xAxes, this->yAxes, image->wcs, image->xAxes, image->yAxes, 0, RemapTable::EQUIRECTANGULAR_PROJECTION);
+		image->remap(table, this);
+		RemapTable::release(table);
 	}
 }
 
@@ -692,20 +800,21 @@ void SunImage<T>::equirectangular_projection(const SunImage<T>* image, bool exac
 template<class T>
 void SunImage<T>::equirectangular_deprojection(const SunImage<T>* image, bool exact)
 {
-	this->zero(this->null());
 	
 	Real dy = Real(image->Yaxes()) / PI, dx = Real(image->Xaxes()) / PI;
 	if(exact)
 	{
+		this->zero(this->null());
+		vector<Real> longitude(this->xAxes), latitude(this->xAxes);
 		for(unsigned iy = 0; iy < this->yAxes; ++iy)
 		{
+			this->toHGS(iy, 0, this->xAxes, &(longitude[0]), &(latitude[0]));
 			for(unsigned ix = 0; ix < this->xAxes; ++ix)
 			{
-				HGS hgs = this->toHGS(RealPixLoc(ix,iy));
-				if(!(!hgs))
+				if(isfinite(longitude[ix]) && isfinite(latitude[ix]))
 				{
-					Real px = (hgs.longitude + MIPI) * dx;
-					Real py = (hgs.latitude + MIPI) * dy;
+					Real px = (longitude[ix] + MIPI) * dx;
+					Real py = (latitude[ix] + MIPI) * dy;
 					this->pixel(ix,iy) = image->interpolate(px, py);
 				}
 			}
@@ -713,69 +822,43 @@ void SunImage<T>::equirectangular_deprojection(const SunImage<T>* image, bool ex
 	}
 	else
 	{
-		Real sun_radius = SunRadius();
-		RealPixLoc sun_center = SunCenter();
-		for(unsigned iy = 0; iy < this->yAxes; ++iy)
-		{
-			Real ry = Real(iy - sun_center.y) / sun_radius;
-			if(ry <= 1. && ry >= -1.)
-			{
-				Real latitude = asin(ry);
-				Real cos_lat = cos(latitude);
-				for(unsigned ix = 0; ix < this->xAxes; ++ix)
-				{
-					Real rx = Real(ix - sun_center.x) / sun_radius;
-					if(rx*rx + ry*ry <= 1)
-					{
-						Real longitude = asin(rx / cos_lat);
-						Real px = (longitude + MIPI) * dx;
-						Real py = (latitude + MIPI) * dy;
-						this->pixel(ix, iy) = image->interpolate(px, py);
-					}
-				}
-			}
-		}
+		// The location of each pixel in the image is given by a remap table
+		const RemapTable* table = RemapTable::get(wcs, this->xAxes, this->yAxes, image->wcs, image->xAxes, image->yAxes, 0, RemapTable::EQUIRECTANGULAR_DEPROJECTION);
+		image->remap(table, this);
+		RemapTable::release(table);
 	}
 }
 
 template<class T>
 void SunImage<T>::Lambert_cylindrical_projection(const SunImage<T>* image, bool exact)
 {
-	this->zero(this->null());
 	T* j = this->pixels;
 	
 	Real dy = 2. / Real(this->yAxes), dx = PI / Real(this->xAxes);
 	
 	if(exact)
 	{
+		this->zero(this->null());
+		vector<Real> longitude(this->xAxes), latitude(this->xAxes), ix(this->xAxes), iy(this->xAxes);
+		for(unsigned px = 0; px < this->xAxes; ++px)
+			longitude[px] = (px * dx) - MIPI;
 		for(unsigned py = 0; py < this->yAxes; ++py)
 		{
-			Real latitude = asin((py * dy) - 1.);
+			fill(latitude.begin(), latitude.end(), asin((py * dy) - 1.));
+			image->toRealPixLoc(this->xAxes, &(longitude[0]), &(latitude[0]), &(ix[0]), &(iy[0]));
 			for(unsigned px = 0; px < this->xAxes; ++px)
 			{
-				Real longitude = (px * dx) - MIPI;
-				*j = image->interpolate(HGS(longitude, latitude));
+				*j = image->interpolate(ix[px], iy[px]);
 				++j;
 			}
 		}
 	}
 	else
 	{
-		Real sun_radius = image->SunRadius();
-		RealPixLoc sun_center = image->SunCenter();
-		for(unsigned py = 0; py < this->yAxes; ++py)
-		{
-			Real latitude = asin((py * dy) - 1.);
-			Real cos_lat = cos(latitude);
-			Real iy = sun_center.y + sin(latitude) * sun_radius;
-			for(unsigned px = 0; px < this->xAxes; ++px)
-			{
-				Real longitude = (px * dx) - MIPI;
-				Real ix = sun_center.x + (sun_radius * cos_lat * sin(longitude));
-				*j = image->interpolate(ix, iy);
-				++j;
-			}
-		}
+		// The location of each pixel in the image is given by a remap table
+		const RemapTable* table = RemapTable::get(wcs, this->xAxes, this->yAxes, image->wcs, image->xAxes, image->yAxes, 0, RemapTable::LAMBERT_CYLINDRICAL_PROJECTION);
+		image->remap(table, this);
+		RemapTable::release(table);
 	}
 }
 
@@ -783,21 +866,22 @@ void SunImage<T>::Lambert_cylindrical_projection(const SunImage<T>* image, bool
 template<class T>
 void SunImage<T>::Lambert_cylindrical_deprojection(const SunImage<T>* image, bool exact)
 {
-	this->zero(this->null());
 	
 	Real dy = Real(image->Yaxes()) / 2., dx = Real(image->Xaxes()) / PI;
 	
 	if(exact)
 	{
+		this->zero(this->null());
+		vector<Real> longitude(this->xAxes), latitude(this->xAxes);
 		for(unsigned iy = 0; iy < this->yAxes; ++iy)
 		{
+			this->toHGS(iy, 0, this->xAxes, &(longitude[0]), &(latitude[0]));
 			for(unsigned ix = 0; ix < this->xAxes; ++ix)
 			{
-				HGS hgs = this->toHGS(RealPixLoc(ix,iy));
-				if(!(!hgs))
+				if(isfinite(longitude[ix]) && isfinite(latitude[ix]))
 				{
-					Real px = (hgs.longitude + MIPI) * dx;
-					Real py = (sin(hgs.latitude) + 1.) * dy;
+					Real px = (longitude[ix] + MIPI) * dx;
+					Real py = (sin(latitude[ix]) + 1.) * dy;
 					this->pixel(ix,iy) = image->interpolate(px, py);
 				}
 			}
@@ -805,28 +889,10 @@ void SunImage<T>::Lambert_cylindrical_deprojection(const SunImage<T>* image, boo
 	}
 	else
 	{
-		Real sun_radius = SunRadius();
-		RealPixLoc sun_center = SunCenter();
-		for(unsigned iy = 0; iy < this->yAxes; ++iy)
-		{
-			Real ry = Real(iy - sun_center.y) / sun_radius;
-			if(ry <= 1. && ry >= -1.)
-			{
-				Real latitude = asin(ry);
-				Real cos_lat = cos(latitude);
-				for(unsigned ix = 0; ix < this->xAxes; ++ix)
-				{
-					Real rx = Real(ix - sun_center.x) / sun_radius;
-					if(rx*rx + ry*ry <= 1)
-					{
-						Real longitude = asin(rx / cos_lat);
-						Real px = (longitude + MIPI) * dx;
-						Real py = (sin(latitude) + 1.) * dy;
-						this->pixel(ix, iy) = image->interpolate(px, py);
-					}
-				}
-			}
-		}
+		// The location of each pixel in the image is given by a remap table
+		const RemapTable* table = RemapTable::get(wcs, this->xAxes, this->yAxes, image->wcs, image->xAxes, image->yAxes, 0, RemapTable::LAMBERT_CYLINDRICAL_DEPROJECTION);
+		image->remap(table, this);
+		RemapTable::release(table);
 	}
 }
 
@@ -834,67 +900,63 @@ void SunImage<T>::Lambert_cylindrical_deprojection(const SunImage<T>* image, boo
 template<class T>
 void SunImage<T>::sinusoidal_projection(const SunImage<T>* image, bool exact)
 {
-	this->zero(this->null());
 	T* j = this->pixels;
 	
 	Real dy = PI / Real(this->yAxes), dx = PI / Real(this->xAxes);
 	
 	if(exact)
 	{
+		this->zero(this->null());
+		vector<Real> longitude(this->xAxes), latitude(this->xAxes), ix(this->xAxes), iy(this->xAxes);
 		for(unsigned py = 0; py < this->yAxes; ++py)
 		{
-			Real latitude = (py * dy) - MIPI;
-			Real cos_lat = cos(latitude);
+			Real row_latitude = (py * dy) - MIPI;
+			Real cos_lat = cos(row_latitude);
+			fill(latitude.begin(), latitude.end(), row_latitude);
 			for(unsigned px = 0; px < this->xAxes; ++px)
 			{
-				Real longitude = ((px * dx) - MIPI) / cos_lat;
-				if(-MIPI <= longitude && longitude <= MIPI)
-					*j = image->interpolate(HGS(longitude, latitude));
-				++j;
+				longitude[px] = ((px * dx) - MIPI) / cos_lat;
+				// We skip the conversion of the pixels outside of the projection
+				if(!(-MIPI <= longitude[px] && longitude[px] <= MIPI))
+					longitude[px] = INF;
 			}
-		}
-	}
-	else
-	{
-		Real sun_radius = image->SunRadius();
-		RealPixLoc sun_center = image->SunCenter();
-		for(unsigned py = 0; py < this->yAxes; ++py)
-		{
-			Real latitude = (py * dy) - MIPI;
-			Real cos_lat = cos(latitude);
-			Real iy = sun_center.y + (sin(latitude) * sun_radius);
+			image->toRealPixLoc(this->xAxes, &(longitude[0]), &(latitude[0]), &(ix[0]), &(iy[0]));
 			for(unsigned px = 0; px < this->xAxes; ++px)
 			{
-				Real longitude = ((px * dx) - MIPI) / cos_lat;
-				if(-MIPI <= longitude && longitude <= MIPI)
-				{
-					Real ix = sun_center.x + (sun_radius * cos_lat * sin(longitude));
-					*j = image->interpolate(ix, iy);
-				}
+				if(longitude[px] != INF)
+					*j = image->interpolate(ix[px], iy[px]);
 				++j;
 			}
 		}
 	}
+	else
+	{
+		// The location of each pixel in the image is given by a remap table
+		const RemapTable* table = RemapTable::get(wcs, this->xAxes, this->yAxes, image->wcs, image->xAxes, image->yAxes, 0, RemapTable::SINUSOIDAL_PROJECTION);
+		image->remap(table, this);
+		RemapTable::release(table);
+	}
 }
 
 
 template<class T>
 void SunImage<T>::sinusoidal_deprojection(const SunImage<T>* image, bool exact)
 {
-	this->zero(this->null());
 	
 	Real dy = Real(image->Yaxes()) / PI, dx = Real(image->Xaxes()) / PI;
 	if(exact)
 	{
+		this->zero(this->null());
+		vector<Real> longitude(this->xAxes), latitude(this->xAxes);
 		for(unsigned iy = 0; iy < this->yAxes; ++iy)
 		{
+			this->toHGS(iy, 0, this->xAxes, &(longitude[0]), &(latitude[0]));
 			for(unsigned ix = 0; ix < this->xAxes; ++ix)
 			{
-				HGS hgs = this->toHGS(RealPixLoc(ix,iy));
-				if(!(!hgs))
+				if(isfinite(longitude[ix]) && isfinite(latitude[ix]))
 				{
-					Real px = ((hgs.longitude * cos(hgs.latitude)) + MIPI) * dx;
-					Real py = (hgs.latitude + MIPI) * dy;
+					Real px = ((longitude[ix] * cos(latitude[ix])) + MIPI) * dx;
+					Real py = (latitude[ix] + MIPI) * dy;
 					this->pixel(ix,iy) = image->interpolate(px, py);
 				}
 			}
@@ -902,28 +964,10 @@ void SunImage<T>::sinusoidal_deprojection(const SunImage<T>* image, bool exact)
 	}
 	else
 	{
-		Real sun_radius = SunRadius();
-		RealPixLoc sun_center = SunCenter();
-		for(unsigned iy = 0; iy < this->yAxes; ++iy)
-		{
-			Real ry = Real(iy - sun_center.y) / sun_radius;
-			if(ry <= 1. && ry >= -1.)
-			{
-				Real latitude = asin(ry);
-				Real cos_lat = cos(latitude);
-				for(unsigned ix = 0; ix < this->xAxes; ++ix)
-				{
-					Real rx = Real(ix - sun_center.x) / sun_radius;
-					if(rx*rx + ry*ry <= 1)
-					{
-						Real longitude = asin(rx / cos_lat);
-						Real px = ((longitude * cos_lat) + MIPI) * dx;
-						Real py = (latitude + MIPI) * dy;
-						this->pixel(ix, iy) = image->interpolate(px, py);
-					}
-				}
-			}
-		}
+		// The location of each pixel in the image is given by a remap table
+		const RemapTable* table = RemapTable::get(wcs, this->xAxes, this->yAxes, image->wcs, image->xAxes, image->yAxes, 0, RemapTable::SINUSOIDAL_DEPROJECTION);
+		image->remap(table, this);
+		RemapTable::release(table);
 	}
 }
 
@@ -946,7 +990,7 @@ template class SunImage<ColorType>;
 /*! Formula coming from Rotation of Doppler features in the solar photosphere by Snodgrass, Herschel B. and Ulrich, Roger K.
 	@return The average angular speed in radians/seconds
 */
-inline Real SunDifferentialAngularSpeed(const Real& latitude)
+Real SunDifferentialAngularSpeed(const Real& latitude)
 {
 
 	const Real A = 14.71;
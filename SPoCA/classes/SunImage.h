@@ -13,6 +13,7 @@
 #include "Header.h"
 #include "Coordinate.h"
 #include "FitsFile.h"
+#include "DiscMask.h"
 
 
 
@@ -95,12 +96,18 @@ class SunImage : public Image<T>
 		//! Accessor to retrieve the wcs
 		WCS& getWCS();
 		
+		//! Accessor to retrieve the wcs
+		const WCS& getWCS() const;
+		
 		//! Routine to read the sun parameters from the header
 		virtual void parseHeader();
 		
 		//! Routine to write the sun parameters to the header
 		virtual void fillHeader();
 		
+		//! Routine that returns the mask of the pixels below a certain radius ratio
+		DiscMask discMask(const Real radiusRatio = 1.0) const;
+		
 		//! Routine to set the pixels above a certain radius ratio to null
 		void nullifyAboveRadius(const Real radiusRatio = 1.0);
 		
@@ -175,6 +182,22 @@ class SunImage : public Image<T>
 		//! Routine that returns the map of HCC coordinates of the image
 		std::vector<HCC> HCCmap() const;
 		
+		//! Routine that converts the pixels [xBegin, xEnd) of row y to Helioprojective cartesian coordinates
+		/*! The coordinates are written in hpc_x and hpc_y, that must have room for xEnd - xBegin values */
+		void toHPC(const unsigned y, const unsigned xBegin, const unsigned xEnd, Real* hpc_x, Real* hpc_y) const;
+		
+		//! Routine that converts the pixels [xBegin, xEnd) of row y to Heliocentric cartesian coordinates
+		/*! The coordinates are written in hcc_x, hcc_y and hcc_z, that must have room for xEnd - xBegin values. Pixels that are not on the sun get infinite coordinates */
+		void toHCC(const unsigned y, const unsigned xBegin, const unsigned xEnd, Real* hcc_x, Real* hcc_y, Real* hcc_z) const;
+		
+		//! Routine that converts the pixels [xBegin, xEnd) of row y to Heliographic Stonyhurst coordinates
+		/*! The coordinates are written in longitude and latitude, that must have room for xEnd - xBegin values. Pixels that are not on the sun get infinite coordinates */
+		void toHGS(const unsigned y, const unsigned xBegin, const unsigned xEnd, Real* longitude, Real* latitude) const;
+		
+		//! Routine that converts number Heliographic Stonyhurst coordinates to pixel locations
+		/*! The pixel locations are written in x and y, that must have room for number values. Null coordinates give infinite or NAN pixel locations */
+		void toRealPixLoc(const unsigned number, const Real* longitude, const Real* latitude, Real* x, Real* y) const;
+		
 		//! Accessor to retrieve the interpolated value of the image in c
 		T interpolate(const HGS& c) const;
 		
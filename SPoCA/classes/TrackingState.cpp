@@ -0,0 +1,173 @@
+#include "TrackingState.h"
+#include <map>
+#include <algorithm>
+
+#include "FitsFile.h"
+#include "Header.h"
+
+//!@file TrackingState.cpp
+
+using namespace std;
+
+TrackingState::TrackingState()
+:latestColor(0), maxDeltaT(0), derotate(true)
+{}
+
+TrackingState::TrackingState(const vector<ColorMap*>& images, const vector<RunLengthColorMap*>& runMaps, const vector<vector<Region*> >& regions, const RegionGraph& tracking_graph, const unsigned maxDeltaT, const bool derotate, const ColorType latestColor)
+:latestColor(latestColor), maxDeltaT(maxDeltaT), derotate(derotate)
+{
+	if(images.empty())
+		return;
+
+	// We keep the maps that can still be compared with a later map, ordered by time
+	vector<unsigned> indices = imageOrder(images);
+	const time_t latestTime = images[indices.back()]->ObservationTime();
+	map<const Region*, pair<unsigned, unsigned> > location;
+	for (unsigned i = 0; i < indices.size(); ++i)
+	{
+		unsigned s = indices[i];
+		if(unsigned(difftime(latestTime, images[s]->ObservationTime())) > maxDeltaT)
+			continue;
+		for (unsigned r = 0; r < regions[s].size(); ++r)
+			location[regions[s][r]] = make_pair(unsigned(maps.size()), r);
+		maps.push_back(images[s]);
+		this->runMaps.push_back(runMaps[s]);
+		this->regions.push_back(regions[s]);
+	}
+
+	// We keep the edges between the regions of those maps, grouped by origin in the order of its edges
+	for (unsigned k = 0; k < this->regions.size(); ++k)
+	{
+		for (unsigned r = 0; r < this->regions[k].size(); ++r)
+		{
+			const RegionGraph::node* n = tracking_graph.get_node(this->regions[k][r]);
+			for (RegionGraph::node::const_iterator it = n->out_begin(); it != n->out_end(); ++it)
+			{
+				map<const Region*, pair<unsigned, unsigned> >::const_iterator to = location.find(it->to->get_region());
+				if(to != location.end())
+					edges.push_back(TrackingEdge(k, r, to->second.first, to->second.second, it->weight));
+			}
+		}
+	}
+}
+
+bool TrackingState::readFits(const string& filename)
+{
+	FitsFile file(filename);
+	if(! file.has("TrackingState"))
+	{
+		cerr<<"Error : "<<filename<<" is not a tracking state file."<<endl;
+		return false;
+	}
+
+	file.moveTo("TrackingState");
+	Header info;
+	file.readHeader(info);
+	latestColor = info.get<ColorType>("TNEWCOLR");
+	maxDeltaT = info.get<unsigned>("TMAXDELT");
+	derotate = info.get<bool>("TDEROT");
+	const unsigned numberMaps = info.get<unsigned>("TNBRIMG");
+
+	vector<unsigned> fromMap, fromRegion, toMap, toRegion;
+	vector<int> weight;
+	file.readColumn("FROM_MAP", fromMap);
+	file.readColumn("FROM_REGION", fromRegion);
+	file.readColumn("TO_MAP", toMap);
+	file.readColumn("TO_REGION", toRegion);
+	file.readColumn("WEIGHT", weight);
+	edges.clear();
+	for (unsigned e = 0; e < weight.size(); ++e)
+		edges.push_back(TrackingEdge(fromMap[e], fromRegion[e], toMap[e], toRegion[e], weight[e]));
+
+	for (unsigned k = 0; k < numberMaps; ++k)
+	{
+		// We recreate the map from its WCS and its runs of pixels
+		file.moveTo("Map_" + toString(k));
+		Header header;
+		file.readHeader(header);
+		ColorMap* map = new ColorMap(header.get<unsigned>("MAPXAXES"), header.get<unsigned>("MAPYAXES"));
+		map->getHeader() = header;
+		map->parseHeader();
+		map->zero(map->null());
+
+		vector<unsigned> y, xBegin, xEnd;
+		vector<ColorType> color;
+		file.readColumn("RUN_Y", y);
+		file.readColumn("RUN_XBEGIN", xBegin);
+		file.readColumn("RUN_XEND", xEnd);
+		file.readColumn("RUN_COLOR", color);
+		for (unsigned i = 0; i < color.size(); ++i)
+			fill(map->row(y[i]) + xBegin[i], map->row(y[i]) + xEnd[i], color[i]);
+		// Only the runs of the map are kept
+		runMaps.push_back(new RunLengthColorMap(map));
+		map->resize(0, 0);
+		maps.push_back(map);
+
+		// The color of the regions is their tracked color
+		file.moveTo("Regions_" + toString(k));
+		vector<Region*> mapRegions;
+		readRegions(file, mapRegions);
+		regions.push_back(mapRegions);
+	}
+	return file.isGood();
+}
+
+bool TrackingState::writeFits(const string& filename) const
+{
+	FitsFile file(filename, FitsFile::overwrite);
+	for (unsigned k = 0; k < maps.size(); ++k)
+	{
+		const RunLengthColorMap* runs = runMaps[k];
+		vector<unsigned> y, xBegin, xEnd;
+		vector<ColorType> color;
+		for (unsigned j = 0; j < runs->Yaxes(); ++j)
+		{
+			for (const ColorRun* r = runs->rowBegin(j); r < runs->rowEnd(j); ++r)
+			{
+				y.push_back(j);
+				xBegin.push_back(r->xBegin);
+				xEnd.push_back(r->xEnd);
+				color.push_back(r->color);
+			}
+		}
+		file.writeTable("Map_" + toString(k));
+		file.writeColumn("RUN_Y", y);
+		file.writeColumn("RUN_XBEGIN", xBegin);
+		file.writeColumn("RUN_XEND", xEnd);
+		file.writeColumn("RUN_COLOR", color);
+
+		// We only write the keywords of the WCS, the others of the header of the map could conflict with the ones of the table
+		Header header = ColorMap(maps[k]->getWCS()).getHeader();
+		header.set("MAPXAXES", runs->Xaxes(), "Size of the X axes of the map");
+		header.set("MAPYAXES", runs->Yaxes(), "Size of the Y axes of the map");
+		file.writeHeader(header);
+
+		file.writeTable("Regions_" + toString(k));
+		writeRegions(file, regions[k]);
+	}
+
+	vector<unsigned> fromMap, fromRegion, toMap, toRegion;
+	vector<int> weight;
+	for (unsigned e = 0; e < edges.size(); ++e)
+	{
+		fromMap.push_back(edges[e].fromMap);
+		fromRegion.push_back(edges[e].fromRegion);
+		toMap.push_back(edges[e].toMap);
+		toRegion.push_back(edges[e].toRegion);
+		weight.push_back(edges[e].weight);
+	}
+	file.writeTable("TrackingState");
+	file.writeColumn("FROM_MAP", fromMap);
+	file.writeColumn("FROM_REGION", fromRegion);
+	file.writeColumn("TO_MAP", toMap);
+	file.writeColumn("TO_REGION", toRegion);
+	file.writeColumn("WEIGHT", weight);
+
+	Header info;
+	info.set("TNEWCOLR", latestColor, "Tracking latest color");
+	info.set("TMAXDELT", maxDeltaT, "Tracking maxDeltaT");
+	info.set("TDEROT", derotate, "Tracking derotate");
+	info.set("TNBRIMG", unsigned(maps.size()), "Tracking number images");
+	file.writeHeader(info);
+	return file.isGood();
+}
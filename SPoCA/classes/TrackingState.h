@@ -0,0 +1,85 @@
+#pragma once
+#ifndef TrackingState_H
+#define TrackingState_H
+
+#include <vector>
+#include <string>
+
+#include "constants.h"
+#include "ColorMap.h"
+#include "Region.h"
+#include "RunLengthColorMap.h"
+#include "trackable.h"
+
+//! An edge of the tracking graph, between the region fromRegion of the map fromMap and the region toRegion of the map toMap
+class TrackingEdge
+{
+	public :
+		unsigned fromMap, fromRegion, toMap, toRegion;
+		int weight;
+
+		TrackingEdge(const unsigned fromMap = 0, const unsigned fromRegion = 0, const unsigned toMap = 0, const unsigned toRegion = 0, const int weight = 0)
+		:fromMap(fromMap), fromRegion(fromRegion), toMap(toMap), toRegion(toRegion), weight(weight){}
+};
+
+//! Class that keeps the recent maps of a tracking, so that new maps can be tracked without the previous files
+/*!
+The state has the maps at most maxDeltaT seconds before the latest map tracked, with their regions and the edges of the tracking graph between them.
+The regions have their tracked color and first observation time, so they are not colored again.
+When new maps are tracked, they are only compared with the maps of the state, and the edges between the maps of the state are the ones of the state,
+so each run only does the work for the new maps.
+The new maps must be after the latest map of the state, the files of the maps of the state are not rewritten.
+
+It is written to a FITS file with:
+ - for each map k, a table "Map_k" with the runs of pixels of the map (see RunLengthColorMap), and the WCS of the map in its header
+ - for each map k, a table "Regions_k" with the regions of the map (see writeRegions)
+ - a table "TrackingState" with the edges, and the tracking parameters and latest color in its header
+*/
+
+class TrackingState
+{
+	public :
+		//! The maps, ordered by time, only their header and WCS are used
+		std::vector<ColorMap*> maps;
+
+		//! The pixels of the maps, as runs
+		std::vector<RunLengthColorMap*> runMaps;
+
+		//! The regions of each map, with their tracked color
+		std::vector<std::vector<Region*> > regions;
+
+		//! The edges of the tracking graph between the regions, grouped by origin in the order of its edges
+		std::vector<TrackingEdge> edges;
+
+		//! The latest color attributed
+		ColorType latestColor;
+
+		//! The maximal number of seconds between 2 tracked regions
+		unsigned maxDeltaT;
+
+		//! If the maps were derotated before comparison
+		bool derotate;
+
+	public :
+		//! Constructor of an empty state
+		TrackingState();
+
+		//! Constructor of the state of a tracking, the maps and regions are not copied
+		/*!
+		Only the maps at most maxDeltaT seconds before the latest one are kept
+		@param images The maps tracked
+		@param runMaps The pixels of the maps tracked, as runs
+		@param regions The regions of each map
+		@param tracking_graph The tracking graph of the regions
+		*/
+		TrackingState(const std::vector<ColorMap*>& images, const std::vector<RunLengthColorMap*>& runMaps, const std::vector<std::vector<Region*> >& regions, const RegionGraph& tracking_graph, const unsigned maxDeltaT, const bool derotate, const ColorType latestColor);
+
+		//! Routine to read the state from a file, the maps, runs and regions are allocated with new
+		/*! The maps have no pixels, their pixels are in runMaps */
+		bool readFits(const std::string& filename);
+
+		//! Routine to write the state to a file
+		bool writeFits(const std::string& filename) const;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "aggregation.h"
+
+//!@file aggregation.cpp
+
+using namespace std;
+extern std::string filenamePrefix;
+
+ColorMap* getAggregatedMap(const ColorMap* map, Real cleaningFactor, Real aggregationFactor, const string& projection)
+{
+	// We convert the factors from arcsec to pixels
+	cleaningFactor /= sqrt(map->PixelArea());
+	aggregationFactor /= sqrt(map->PixelArea());
+	
+	ColorMap* aggregated = new ColorMap(map);
+
+	#if defined DEBUG
+	aggregated->writeFits(filenamePrefix + "pure.fits");
+	#endif
+	
+	if(projection == "exact")
+	{
+		/*! Clean the color map to remove very small components (like protons)*/
+		aggregated->erodeCircularProjected(cleaningFactor, 0);
+	
+		#if defined DEBUG
+		aggregated->writeFits(filenamePrefix + "eroded.fits");
+		#endif
+	
+		/*! Aggregate the blobs together */
+		aggregated->dilateCircularProjected(cleaningFactor + aggregationFactor, 0);
+	
+		#if defined DEBUG
+		aggregated->writeFits(filenamePrefix + "dilated.fits");
+		#endif
+	
+		/*! Give back the original size */
+		aggregated->erodeCircularProjected(aggregationFactor, 0);
+	
+		#if defined DEBUG
+		aggregated->writeFits(filenamePrefix + "closed.fits");
+		#endif
+	}
+	else
+	{
+		/*! Apply the projection */
+		if(projection == "equirectangular")
+		{
+			aggregated->equirectangular_projection(map, false);
+			#if defined DEBUG
+			aggregated->writeFits(filenamePrefix + "equirectangular_projection.fits");
+			#endif
+			// We adjust the factors because in the projection the pixel size changes
+			cleaningFactor *= (2./3.);
+			aggregationFactor *= (2./3.);
+		}
+		else if(projection == "lambert")
+		{
+			aggregated->Lambert_cylindrical_projection(map, false);
+			#if defined DEBUG
+			aggregated->writeFits(filenamePrefix + "Lambert_cylindrical_projection.fits");
+			#endif
+			// We adjust the factors because in the projection the pixel size changes
+			cleaningFactor *= (2./3.);
+			aggregationFactor *= (2./3.);
+		}
+		else if(projection == "sinusoidal")
+		{
+			aggregated->sinusoidal_projection(map, false);
+			#if defined DEBUG
+			aggregated->writeFits(filenamePrefix + "sinusoidal_projection.fits");
+			#endif
+			// We adjust the factors because in the projection the pixel size changes
+			cleaningFactor *= (2./3.);
+			aggregationFactor *= (2./3.);
+		}
+		else if(projection != "none")
+		{
+			cerr<<"Unknown projection type "<<projection<<endl;
+			exit(EXIT_FAILURE);
+		}
+	
+		/*! Clean the color map to remove very small components (like protons), aggregate the blobs together and give back the original size */
+		aggregated->closeCircular(cleaningFactor, aggregationFactor, 0);
+	
+		#if defined DEBUG
+		aggregated->writeFits(filenamePrefix + "closed.fits");
+		#endif
+	
+		/* Apply the deprojection */
+		if(projection == "equirectangular")
+		{
+			// We move the pixels of the projection to a temporary map, and take new pixels for the deprojection
+			ColorMap projeted(aggregated->getWCS());
+			projeted.swapPixels(*aggregated);
+			aggregated->resize(projeted.Xaxes(), projeted.Yaxes());
+			aggregated->equirectangular_deprojection(&projeted, false);
+			#if defined DEBUG
+			aggregated->writeFits(filenamePrefix + "equirectangular_deprojection.fits");
+			#endif
+		
+		}
+		else if(projection == "lambert")
+		{
+			// We move the pixels of the projection to a temporary map, and take new pixels for the deprojection
+			ColorMap projeted(aggregated->getWCS());
+			projeted.swapPixels(*aggregated);
+			aggregated->resize(projeted.Xaxes(), projeted.Yaxes());
+			aggregated->Lambert_cylindrical_deprojection(&projeted, false);
+			#if defined DEBUG
+			aggregated->writeFits(filenamePrefix + "Lambert_cylindrical_deprojection.fits");
+			#endif
+		}
+		else if(projection == "sinusoidal")
+		{
+			// We move the pixels of the projection to a temporary map, and take new pixels for the deprojection
+			ColorMap projeted(aggregated->getWCS());
+			projeted.swapPixels(*aggregated);
+			aggregated->resize(projeted.Xaxes(), projeted.Yaxes());
+			aggregated->sinusoidal_deprojection(&projeted, false);
+			#if defined DEBUG
+			aggregated->writeFits(filenamePrefix + "sinusoidal_deprojection.fits");
+			#endif
+		}
+		else if(projection != "none")
+		{
+			cerr<<"Unknown projection type "<<projection<<endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+	/*! Remove the parts off limb and colorize */
+	aggregated->nullifyAboveRadius(1.); 
+	aggregated->colorizeConnectedComponents(1);
+	
+	#if defined DEBUG
+	aggregated->writeFits(filenamePrefix + "aggregated.fits");
+	#endif
+
+	return aggregated;
+}
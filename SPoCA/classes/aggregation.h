@@ -0,0 +1,26 @@
+#pragma once
+#ifndef Aggregation_H
+#define Aggregation_H
+
+#include <string>
+
+#include "constants.h"
+#include "ColorMap.h"
+
+/*!
+@file aggregation.h
+Aggregation of the blobs of a binary map into regions, shared by the maps of Active Region (AR) and of Coronal Hole (CH).
+
+The map is optionally projected, cleaned of the small blobs and closed by ColorMap::closeCircular,
+deprojected into new pixels, and the connected components are colored from 1.
+*/
+
+//! Return a new map of the aggregated blobs of map
+/*!
+@param cleaningFactor The size in arcsec of the erosion that removes the small blobs
+@param aggregationFactor The size in arcsec of the closing that aggregates the blobs
+@param projection The projection in which the morphology is done, one of none, equirectangular, lambert, sinusoidal or exact
+*/
+ColorMap* getAggregatedMap(const ColorMap* map, Real cleaningFactor, Real aggregationFactor, const std::string& projection = "none");
+
+#endif
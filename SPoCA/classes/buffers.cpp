@@ -0,0 +1,80 @@
+#include "buffers.h"
+#include <cstdlib>
+#include <iostream>
+#include <deque>
+#include <utility>
+#include <pthread.h>
+
+//!@file buffers.cpp
+
+using namespace std;
+
+//! The buffers of the pool with their size, the most recently released last
+static deque< pair<size_t, void*> > bufferPool;
+
+//! Mutex protecting the pool
+static pthread_mutex_t bufferPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+void* allocateBuffer(const size_t size)
+{
+	if(size == 0)
+		return NULL;
+
+	pthread_mutex_lock(&bufferPoolMutex);
+	for(deque< pair<size_t, void*> >::reverse_iterator b = bufferPool.rbegin(); b != bufferPool.rend(); ++b)
+	{
+		if(b->first == size)
+		{
+			void* buffer = b->second;
+			bufferPool.erase(--(b.base()));
+			pthread_mutex_unlock(&bufferPoolMutex);
+			return buffer;
+		}
+	}
+	pthread_mutex_unlock(&bufferPoolMutex);
+
+	void* buffer = NULL;
+	if(posix_memalign(&buffer, BUFFER_ALIGNMENT, size) != 0)
+	{
+		// The pool may be holding the memory we need
+		clearBufferPool();
+		if(posix_memalign(&buffer, BUFFER_ALIGNMENT, size) != 0)
+		{
+			cerr<<"Error: could not allocate "<<size<<" bytes of memory"<<endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+	return buffer;
+}
+
+void releaseBuffer(void* buffer, const size_t size)
+{
+	if(buffer == NULL)
+		return;
+
+	if(BUFFER_POOL_SIZE == 0)
+	{
+		free(buffer);
+		return;
+	}
+
+	pthread_mutex_lock(&bufferPoolMutex);
+	bufferPool.push_back(make_pair(size, buffer));
+	while(bufferPool.size() > BUFFER_POOL_SIZE)
+	{
+		free(bufferPool.front().second);
+		bufferPool.pop_front();
+	}
+	pthread_mutex_unlock(&bufferPoolMutex);
+}
+
+void clearBufferPool()
+{
+	pthread_mutex_lock(&bufferPoolMutex);
+	while(! bufferPool.empty())
+	{
+		free(bufferPool.front().second);
+		bufferPool.pop_front();
+	}
+	pthread_mutex_unlock(&bufferPoolMutex);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef Buffers_H
+#define Buffers_H
+
+#include <cstddef>
+
+#include "constants.h"
+
+/*!
+@file buffers.h
+Routines to allocate the memory of the images.
+
+The buffers are aligned on BUFFER_ALIGNMENT bytes, so that the rows can be vectorized.
+When a buffer is released, it is kept in a pool instead of being freed, so that a temporary image of the same size allocated later can reuse it.
+The pool keeps at most BUFFER_POOL_SIZE buffers, the least recently released are freed first (see @ref Compilation_Options).
+*/
+
+//! Routine that returns a buffer of size bytes, taken from the pool if possible
+/*! Returns NULL if size is 0. The buffer must be given back with releaseBuffer */
+void* allocateBuffer(const size_t size);
+
+//! Routine to give back a buffer of size bytes obtained with allocateBuffer
+void releaseBuffer(void* buffer, const size_t size);
+
+//! Routine that frees all the buffers of the pool
+void clearBufferPool();
+
+#endif
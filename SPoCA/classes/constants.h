@@ -131,6 +131,61 @@ See constants.h for the actual values.
 #define FONT "FreeSans"
 #endif
 
+/*!
+@page Compilation_Options
+@param NUMBER_THREADS The number of threads used by the parallel routines (see parallel.h)
+<BR> 0 means one thread per available core, 1 disables multithreading
+*/
+#if ! defined(NUMBER_THREADS)
+#define NUMBER_THREADS 0
+#endif
+
+/*!
+@page Compilation_Options
+@param REMAP_CACHE_SIZE The maximal number of unused remap tables kept in cache (see RemapTable.h)
+<BR> A remap table uses 12 bytes per pixel of the destination image
+*/
+#if ! defined(REMAP_CACHE_SIZE)
+#define REMAP_CACHE_SIZE 4
+#endif
+
+/*!
+@page Compilation_Options
+@param BUFFER_ALIGNMENT The alignment in bytes of the pixels of the images (see buffers.h)
+<BR> It must be a power of 2, and a multiple of the size of a pointer
+*/
+#if ! defined(BUFFER_ALIGNMENT)
+#define BUFFER_ALIGNMENT 64
+#endif
+
+/*!
+@page Compilation_Options
+@param BUFFER_POOL_SIZE The maximal number of released pixel buffers kept for reuse by new images (see buffers.h)
+<BR> 0 disables the pool
+*/
+#if ! defined(BUFFER_POOL_SIZE)
+#define BUFFER_POOL_SIZE 4
+#endif
+
+/*!
+@page Compilation_Options
+@param AREA_MAP_CACHE_SIZE The number of unused maps of the deprojected area of the pixels kept for reuse by images of the same geometry (see DeprojectedAreaMap.h)
+<BR> It must be at least 1
+*/
+#if ! defined(AREA_MAP_CACHE_SIZE)
+#define AREA_MAP_CACHE_SIZE 2
+#endif
+
+/*!
+@page Compilation_Options
+@param ESTIMATE_QUANTILES If defined, the median and the quartiles of the RegionStats and SegmentationStats are estimated in bounded memory, instead of keeping all the intensities (see IntensityDistribution.h)
+@param QUANTILE_RELATIVE_ACCURACY The maximal relative error of the estimated quantiles when ESTIMATE_QUANTILES is defined
+<BR> It must be in (0, 1), the memory used is inversely proportional to it
+*/
+#if ! defined(QUANTILE_RELATIVE_ACCURACY)
+#define QUANTILE_RELATIVE_ACCURACY 0.005
+#endif
+
 
 /*!
 @page Compilation_Options
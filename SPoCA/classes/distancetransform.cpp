@@ -0,0 +1,139 @@
+#include "distancetransform.h"
+#include <vector>
+#include <cmath>
+
+#include "parallel.h"
+
+//!@file distancetransform.cpp
+
+using namespace std;
+
+//! Functor that computes for each pixel of the columns [beginColumn, endColumn) the distance to the nearest source in its column
+class ColumnDistance
+{
+	private :
+		const unsigned xAxes;
+		const unsigned yAxes;
+		const unsigned char* sources;
+		unsigned* distance;
+	public :
+		ColumnDistance(const unsigned xAxes, const unsigned yAxes, const unsigned char* sources, unsigned* distance)
+		:xAxes(xAxes), yAxes(yAxes), sources(sources), distance(distance)
+		{}
+		void operator()(const unsigned beginColumn, const unsigned endColumn)
+		{
+			// The distance when there is no source in the column
+			const unsigned infinity = xAxes + yAxes;
+			for(unsigned x = beginColumn; x < endColumn; ++x)
+				distance[x] = sources[x] ? 0 : infinity;
+			for(unsigned y = 1; y < yAxes; ++y)
+			{
+				const unsigned char* source = sources + y * xAxes;
+				unsigned* row = distance + y * xAxes;
+				const unsigned* previous = row - xAxes;
+				for(unsigned x = beginColumn; x < endColumn; ++x)
+					row[x] = source[x] ? 0 : (previous[x] < infinity ? previous[x] + 1 : infinity);
+			}
+			for(unsigned y = yAxes - 1; y > 0; --y)
+			{
+				unsigned* row = distance + (y - 1) * xAxes;
+				const unsigned* next = row + xAxes;
+				for(unsigned x = beginColumn; x < endColumn; ++x)
+					if(next[x] < row[x])
+						row[x] = next[x] + 1;
+			}
+		}
+};
+
+//! Functor that computes the squared distances of the rows [beginRow, endRow) from the column distances
+class RowDistance
+{
+	private :
+		const unsigned xAxes;
+		unsigned* distance;
+
+		//! Squared distance between pixel x and the source nearest to the pixel i in its column
+		static long long f(const long long x, const long long i, const long long g)
+		{return (x - i) * (x - i) + g * g;}
+
+		//! Greatest x at which the parabola centered at i is below or equal to the one centered at u > i
+		static long long separation(const long long i, const long long u, const long long gi, const long long gu)
+		{
+			long long numerator = (u * u - i * i) + (gu * gu - gi * gi);
+			long long denominator = 2 * (u - i);
+			// We want the floor of the division, also for negative numerators
+			return numerator >= 0 ? numerator / denominator : - ((- numerator + denominator - 1) / denominator);
+		}
+
+	public :
+		RowDistance(const unsigned xAxes, unsigned* distance)
+		:xAxes(xAxes), distance(distance)
+		{}
+		void operator()(const unsigned beginRow, const unsigned endRow)
+		{
+			// g is the column distance, s the centers of the parabolas of the lower envelope, t the first pixel where they are the lowest
+			vector<long long> g(xAxes), s(xAxes), t(xAxes);
+			for(unsigned y = beginRow; y < endRow; ++y)
+			{
+				unsigned* row = distance + y * xAxes;
+				for(unsigned x = 0; x < xAxes; ++x)
+					g[x] = row[x];
+
+				long long q = 0;
+				s[0] = 0;
+				t[0] = 0;
+				for(long long u = 1; u < xAxes; ++u)
+				{
+					while(q >= 0 && f(t[q], s[q], g[s[q]]) > f(t[q], u, g[u]))
+						--q;
+					if(q < 0)
+					{
+						q = 0;
+						s[0] = u;
+					}
+					else
+					{
+						long long w = 1 + separation(s[q], u, g[s[q]], g[u]);
+						if(w < xAxes)
+						{
+							++q;
+							s[q] = u;
+							t[q] = w;
+						}
+					}
+				}
+				for(long long u = xAxes - 1; u >= 0; --u)
+				{
+					row[u] = unsigned(f(u, s[q], g[s[q]]));
+					if(u == t[q])
+						--q;
+				}
+			}
+		}
+};
+
+void squaredDistanceTransform(const unsigned xAxes, const unsigned yAxes, const unsigned char* sources, unsigned* distance)
+{
+	if(xAxes == 0 || yAxes == 0)
+		return;
+
+	ColumnDistance columnDistance(xAxes, yAxes, sources, distance);
+	parallel_for(xAxes, columnDistance, 64);
+
+	RowDistance rowDistance(xAxes, distance);
+	parallel_for_rows(yAxes, rowDistance);
+}
+
+unsigned maximalSquaredDistance(const Real radius)
+{
+	if(! (radius >= 1))
+		return 0;
+
+	// We start from an approximation and correct it with the same test than sqrt(n) <= radius
+	unsigned n = unsigned(radius * radius);
+	while(sqrt(Real(n + 1)) <= radius)
+		++n;
+	while(n > 0 && sqrt(Real(n)) > radius)
+		--n;
+	return n;
+}
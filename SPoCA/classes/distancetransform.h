@@ -0,0 +1,30 @@
+#pragma once
+#ifndef DistanceTransform_H
+#define DistanceTransform_H
+
+#include "constants.h"
+
+/*!
+@file distancetransform.h
+Exact euclidean distance transform of a grid, in linear time.
+
+The transform is separable: a first pass computes for each pixel the distance to the nearest source in its column,
+and a second pass computes for each row the lower envelope of the parabolas centered on the pixels of the row
+(A. Meijster, J.B.T.M. Roerdink, W.H. Hesselink, "A General Algorithm for Computing Distance Transforms in Linear Time", 2000).
+All computations are done with integers, so the squared distances are exact.
+The columns, and then the rows, are shared between the threads (see parallel.h).
+*/
+
+//! Routine that computes for each pixel of a grid of size xAxes x yAxes the squared euclidean distance to the nearest source pixel
+/*!
+@param sources For each pixel of the grid, non zero if the pixel is a source
+@param distance The squared distances, must have xAxes * yAxes elements
+If there is no source, the squared distance is greater than (xAxes + yAxes)²
+*/
+void squaredDistanceTransform(const unsigned xAxes, const unsigned yAxes, const unsigned char* sources, unsigned* distance);
+
+//! Routine that returns the greatest squared distance between 2 pixels that is smaller or equal than radius²
+/*! i.e. the greatest integer n such that sqrt(n) <= radius, or 0 if the radius is smaller than 1 */
+unsigned maximalSquaredDistance(const Real radius);
+
+#endif
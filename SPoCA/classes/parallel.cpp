@@ -0,0 +1,70 @@
+#include "parallel.h"
+#include <unistd.h>
+#include <vector>
+
+//!@file parallel.cpp
+
+using namespace std;
+
+//! Number of threads requested, 0 means one per core
+static unsigned requestedNumberThreads = NUMBER_THREADS;
+
+//! Set in the threads that are executing a parallel routine
+static __thread bool parallelRegion = false;
+
+//! Argument of the threads started by runThreads
+struct ThreadArgument
+{
+	void* (*routine)(void*);
+	void* argument;
+};
+
+//! Routine executed by the threads started by runThreads
+static void* threadRoutine(void* argument)
+{
+	ThreadArgument* thread = static_cast<ThreadArgument*>(argument);
+	parallelRegion = true;
+	return thread->routine(thread->argument);
+}
+
+unsigned numberThreads()
+{
+	if(requestedNumberThreads > 0)
+		return requestedNumberThreads;
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? unsigned(cores) : 1;
+}
+
+void setNumberThreads(const unsigned number)
+{
+	requestedNumberThreads = number;
+}
+
+bool inParallelRegion()
+{
+	return parallelRegion;
+}
+
+void runThreads(void* (*routine)(void*), void* argument, const unsigned number)
+{
+	ThreadArgument thread = {routine, argument};
+	vector<pthread_t> threads;
+	threads.reserve(number);
+	for(unsigned t = 1; t < number; ++t)
+	{
+		pthread_t id;
+		// If we cannot create more threads, the remaining ones will do the work
+		if(pthread_create(&id, NULL, threadRoutine, &thread) != 0)
+			break;
+		threads.push_back(id);
+	}
+
+	// The calling thread takes its share of the work
+	parallelRegion = true;
+	routine(argument);
+	parallelRegion = false;
+
+	for(unsigned t = 0; t < threads.size(); ++t)
+		pthread_join(threads[t], NULL);
+}
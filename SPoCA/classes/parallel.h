@@ -0,0 +1,97 @@
+#pragma once
+#ifndef Parallel_H
+#define Parallel_H
+
+#include <pthread.h>
+
+#include "constants.h"
+
+/*!
+@file parallel.h
+Routines to share the iterations of a loop between several threads.
+
+The loops are split in chunks of consecutive iterations, that the threads take one after the other until there is none left.
+The routines are not recursive: a parallel routine called from inside another parallel routine is executed by the calling thread only.
+*/
+
+//! Return the number of threads used by the parallel routines
+unsigned numberThreads();
+
+//! Set the number of threads used by the parallel routines
+/*! @param number The number of threads, 0 means one thread per available core */
+void setNumberThreads(const unsigned number);
+
+//! Tell if the calling thread is executing a parallel routine
+bool inParallelRegion();
+
+//! Routine that execute the routine with argument in number threads (the calling thread included), and wait for them to finish
+void runThreads(void* (*routine)(void*), void* argument, const unsigned number);
+
+//! Class used by parallel_for to share the chunks of a loop between the threads
+template<class Function>
+class ParallelLoop
+{
+	private :
+		Function& function;
+		const unsigned size;
+		const unsigned chunk;
+		unsigned next;
+
+	public :
+		ParallelLoop(Function& function, const unsigned size, const unsigned chunk)
+		:function(function), size(size), chunk(chunk), next(0)
+		{}
+
+		static void* run(void* argument)
+		{
+			ParallelLoop* loop = static_cast<ParallelLoop*>(argument);
+			for(unsigned begin = __sync_fetch_and_add(&loop->next, loop->chunk); begin < loop->size; begin = __sync_fetch_and_add(&loop->next, loop->chunk))
+			{
+				loop->function(begin, begin + loop->chunk < loop->size ? begin + loop->chunk : loop->size);
+			}
+			return NULL;
+		}
+};
+
+//! Routine that calls function(begin, end) on consecutive chunks of [0, size), using numberThreads threads
+/*!
+@param size The number of iterations of the loop
+@param function A functor with an operator()(unsigned begin, unsigned end), it must be safe to call it concurrently on disjoint ranges
+@param chunk The number of iterations given to a thread at a time
+*/
+template<class Function>
+void parallel_for(const unsigned size, Function& function, unsigned chunk = 1)
+{
+	if(chunk == 0)
+		chunk = 1;
+	unsigned number = numberThreads();
+	if(number > (size + chunk - 1) / chunk)
+		number = (size + chunk - 1) / chunk;
+
+	if(number <= 1 || inParallelRegion())
+	{
+		if(size > 0)
+			function(0, size);
+	}
+	else
+	{
+		ParallelLoop<Function> loop(function, size, chunk);
+		runThreads(&ParallelLoop<Function>::run, &loop, number);
+	}
+}
+
+//! Routine that calls function(beginRow, endRow) on tiles of consecutive rows of an image with yAxes rows, using numberThreads threads
+/*!
+@param yAxes The number of rows of the image
+@param function A functor with an operator()(unsigned beginRow, unsigned endRow), it must be safe to call it concurrently on disjoint tiles
+@param tileRows The number of rows of a tile, 0 to make about 8 tiles per thread
+*/
+template<class Function>
+void parallel_for_rows(const unsigned yAxes, Function& function, unsigned tileRows = 0)
+{
+	if(tileRows == 0)
+		tileRows = yAxes / (8 * numberThreads());
+	parallel_for(yAxes, function, tileRows);
+}
+
+#endif
@@ -1,6 +1,9 @@
 #include "trackable.h"
 #include <map>
 
+#include "ColorLUT.h"
+#include "parallel.h"
+
 using namespace std;
 
 
@@ -55,10 +58,69 @@ unsigned overlay_derotate(ColorMap* image1, const Region* region1, ColorMap* ima
 
 }
 
+// Compute the box of the pixels of image2 that can be common with region1 of image1, with or without derotation
+void trackingBox(ColorMap* image1, const Region* region1, ColorMap* image2, const bool derotate, PixLoc& boxmin, PixLoc& boxmax)
+{
+	if(! derotate)
+	{
+		boxmin = region1->Boxmin();
+		boxmax = region1->Boxmax();
+		return;
+	}
+
+	// Like in overlay_derotate, a corner whose projection is null is replaced by the corner of region2, so it does not limit the box
+	// The corners are truncated the same way, so the box contains the intersection scanned by overlay_derotate
+	RealPixLoc r1_boxmin = image1->shift_like(region1->Boxmin(), image2);
+	RealPixLoc r1_boxmax = image1->shift_like(region1->Boxmax(), image2);
+	boxmin.x = !r1_boxmin || r1_boxmin.x < 0 ? 0 : unsigned(r1_boxmin.x);
+	boxmin.y = !r1_boxmin || r1_boxmin.y < 0 ? 0 : unsigned(r1_boxmin.y);
+	boxmax.x = !r1_boxmax || r1_boxmax.x < 0 ? numeric_limits<unsigned>::max() : unsigned(r1_boxmax.x);
+	boxmax.y = !r1_boxmax || r1_boxmax.y < 0 ? numeric_limits<unsigned>::max() : unsigned(r1_boxmax.y);
+}
+
+// Compute the number of pixels common to 2 regions from their spans, row by row
+unsigned overlay(const Region* region1, const Region* region2)
+{
+	unsigned intersectPixels = 0;
+	const vector<RegionSpan>& spans1 = region1->Spans();
+	const vector<RegionSpan>& spans2 = region2->Spans();
+	
+	// We skip the spans of region1 before the first row of region2
+	vector<RegionSpan>::const_iterator s1 = spans1.begin();
+	while (s1 != spans1.end() && s1->y < region2->Boxmin().y)
+		++s1;
+	vector<RegionSpan>::const_iterator s2 = spans2.begin();
+	
+	// The spans are ordered by row and then by column, so we advance the one that ends first
+	while (s1 != spans1.end() && s2 != spans2.end())
+	{
+		if(s1->y < s2->y)
+			++s1;
+		else if(s2->y < s1->y)
+			++s2;
+		else
+		{
+			const unsigned xBegin = s1->xBegin > s2->xBegin ? s1->xBegin : s2->xBegin;
+			const unsigned xEnd = s1->xEnd < s2->xEnd ? s1->xEnd : s2->xEnd;
+			if(xBegin < xEnd)
+				intersectPixels += xEnd - xBegin;
+			if(s1->xEnd < s2->xEnd)
+				++s1;
+			else
+				++s2;
+		}
+	}
+	
+	return intersectPixels;
+}
 
 // Compute the number of pixels common to 2 regions from 2 images
 unsigned overlay(ColorMap* image1, const Region* region1, ColorMap* image2, const Region* region2)
 {
+	// If the regions have their spans, only the spans are compared
+	if(region1->hasSpans() && region2->hasSpans())
+		return overlay(region1, region2);
+	
 	unsigned intersectPixels = 0;
 	ColorType setValue1 = image1->pixel(region1->FirstPixel());
 	ColorType setValue2 = image2->pixel(region2->FirstPixel());
@@ -89,36 +151,297 @@ unsigned overlay(ColorMap* image1, const Region* region1, ColorMap* image2, cons
 
 }
 
-// Color a node
+//! Class that counts the pixels common to each pair of regions from 2 images
+/*!
+A pixel of image2 is common to region1 and region2 if it has their colors (in image1 after derotation) and if it lies in the intersection of their boxes scanned by overlay_derotate or overlay.
+The regions of a color are found with a ColorLUT giving the first region of the color, and a list of the next ones, in case several regions have the same color.
+The images are only used for the boxes of the regions of image1 in image2, their pixels are not read.
+*/
+class OverlapCounter
+{
+	private :
+		const unsigned numberRegions1, numberRegions2;
+		std::vector<PixLoc> boxmin1, boxmax1, boxmin2, boxmax2;
+		ColorLUT first1, first2;
+		std::vector<unsigned> next1, next2;
+		std::vector<unsigned>& overlaps;
+
+	public :
+		OverlapCounter(ColorMap* image1, const vector<Region*>& regions1, const vector<ColorType>& colors1, ColorMap* image2, const vector<Region*>& regions2, const vector<ColorType>& colors2, const bool derotate, vector<unsigned>& overlaps)
+		:numberRegions1(regions1.size()), numberRegions2(regions2.size()), boxmin1(regions1.size()), boxmax1(regions1.size()), boxmin2(regions2.size()), boxmax2(regions2.size()), first1(regions1.size()), first2(regions2.size()), next1(regions1.size()), next2(regions2.size()), overlaps(overlaps)
+		{
+			overlaps.assign(numberRegions1 * numberRegions2, 0);
+			// The regions are added in decreasing order, so the lists of a color are in increasing order
+			for (unsigned r1 = numberRegions1; r1 > 0; --r1)
+			{
+				trackingBox(image1, regions1[r1 - 1], image2, derotate, boxmin1[r1 - 1], boxmax1[r1 - 1]);
+				next1[r1 - 1] = first1(colors1[r1 - 1]);
+				first1.set(colors1[r1 - 1], r1 - 1);
+			}
+			for (unsigned r2 = numberRegions2; r2 > 0; --r2)
+			{
+				boxmin2[r2 - 1] = regions2[r2 - 1]->Boxmin();
+				boxmax2[r2 - 1] = regions2[r2 - 1]->Boxmax();
+				next2[r2 - 1] = first2(colors2[r2 - 1]);
+				first2.set(colors2[r2 - 1], r2 - 1);
+			}
+		}
+
+		// Tell if some region of image2 has the color
+		bool isRegionColor2(const ColorType color2) const
+		{
+			return first2(color2) != numberRegions2;
+		}
+
+		// Count the pixel (x, y) of color2 in image2, and of color1 in image1
+		void add(const unsigned x, const unsigned y, const ColorType color1, const ColorType color2)
+		{
+			for (unsigned r2 = first2(color2); r2 != numberRegions2; r2 = next2[r2])
+			{
+				if(x < boxmin2[r2].x || x > boxmax2[r2].x || y < boxmin2[r2].y || y > boxmax2[r2].y)
+					continue;
+				for (unsigned r1 = first1(color1); r1 != numberRegions1; r1 = next1[r1])
+				{
+					if(x >= boxmin1[r1].x && x <= boxmax1[r1].x && y >= boxmin1[r1].y && y <= boxmax1[r1].y)
+						++overlaps[r1 * numberRegions2 + r2];
+				}
+			}
+		}
+};
+
+//! Routine that returns the colors of the regions of a map
+template<class Map>
+static vector<ColorType> regionColors(const Map* image, const vector<Region*>& regions)
+{
+	vector<ColorType> colors(regions.size());
+	for (unsigned r = 0; r < regions.size(); ++r)
+		colors[r] = image->pixel(regions[r]->FirstPixel());
+	return colors;
+}
+
+//! Routine that returns the rows [Ymin, Ymax] of the boxes of the regions
+static void regionRows(const vector<Region*>& regions, unsigned& Ymin, unsigned& Ymax)
+{
+	Ymin = regions[0]->Boxmin().y;
+	Ymax = regions[0]->Boxmax().y;
+	for (unsigned r = 1; r < regions.size(); ++r)
+	{
+		Ymin = regions[r]->Boxmin().y < Ymin ? regions[r]->Boxmin().y : Ymin;
+		Ymax = regions[r]->Boxmax().y > Ymax ? regions[r]->Boxmax().y : Ymax;
+	}
+}
+
+//! Routine that projects the pixels [xBegin, xEnd) of row y of image2 into image1 like with shift_like
+/*! The locations of the pixels whose projection is null are not finite */
+static void projectRun(const ColorMap* image1, const ColorMap* image2, const unsigned y, const unsigned xBegin, const unsigned xEnd, Real* longitude, Real* latitude, Real* locationX, Real* locationY)
+{
+	const int delta_t = int(difftime(image1->ObservationTime(), image2->ObservationTime()));
+	image2->toHGS(y, xBegin, xEnd, longitude, latitude);
+	for (unsigned i = 0; i < xEnd - xBegin; ++i)
+	{
+		if(isfinite(longitude[i]) && isfinite(latitude[i]))
+		{
+			longitude[i] += delta_t * SunDifferentialAngularSpeed(latitude[i]);
+			// The projection of the coordinate may lie outside of the sundisc ==> the projection is null
+			if(longitude[i] > MIPI || longitude[i] < -MIPI)
+				longitude[i] = INF;
+		}
+	}
+	image1->toRealPixLoc(xEnd - xBegin, longitude, latitude, locationX, locationY);
+}
+
+// Compute the number of pixels common to each pair of regions from 2 run length maps, with or without derotation, in a single scan of the runs of image2
+void overlay(const RunLengthColorMap* image1, const vector<Region*>& regions1, const RunLengthColorMap* image2, const vector<Region*>& regions2, const bool derotate, vector<unsigned>& overlaps)
+{
+	// The coordinates are converted by maps without pixels
+	ColorMap geometry1(image1->getWCS()), geometry2(image2->getWCS());
+	OverlapCounter counter(&geometry1, regions1, regionColors(image1, regions1), &geometry2, regions2, regionColors(image2, regions2), derotate, overlaps);
+	if(regions1.empty() || regions2.empty())
+		return;
+
+	unsigned Ymin, Ymax;
+	regionRows(regions2, Ymin, Ymax);
+
+	const unsigned Xaxes = image2->Xaxes();
+	vector<Real> longitude(Xaxes), latitude(Xaxes), locationX(Xaxes), locationY(Xaxes);
+	for (unsigned y = Ymin; y <= Ymax && y < image2->Yaxes(); ++y)
+	{
+		const ColorRun* run1 = y < image1->Yaxes() ? image1->rowBegin(y) : NULL;
+		const ColorRun* end1 = y < image1->Yaxes() ? image1->rowEnd(y) : NULL;
+		for (const ColorRun* run2 = image2->rowBegin(y); run2 < image2->rowEnd(y); ++run2)
+		{
+			if(! counter.isRegionColor2(run2->color))
+				continue;
+
+			if(derotate)
+			{
+				projectRun(&geometry1, &geometry2, y, run2->xBegin, run2->xEnd, &(longitude[0]), &(latitude[0]), &(locationX[0]), &(locationY[0]));
+				for (unsigned i = 0; i < run2->length(); ++i)
+				{
+					if(isfinite(locationX[i]) && isfinite(locationY[i]))
+						counter.add(run2->xBegin + i, y, image1->interpolate(RealPixLoc(locationX[i], locationY[i])), run2->color);
+				}
+			}
+			else
+			{
+				// The runs of a row are ordered, so the runs of image1 that overlap run2 are after the ones of the previous run2
+				// The pixels of image1 outside of its runs are null, and null is not the color of a region
+				while (run1 < end1 && run1->xEnd <= run2->xBegin)
+					++run1;
+				for (const ColorRun* r1 = run1; r1 < end1 && r1->xBegin < run2->xEnd; ++r1)
+				{
+					const unsigned xEnd = r1->xEnd < run2->xEnd ? r1->xEnd : run2->xEnd;
+					for (unsigned x = r1->xBegin > run2->xBegin ? r1->xBegin : run2->xBegin; x < xEnd; ++x)
+						counter.add(x, y, r1->color, run2->color);
+				}
+			}
+		}
+	}
+}
+
+//! Routine that tells if all the regions have their spans
+static bool haveSpans(const vector<Region*>& regions)
+{
+	for (unsigned r = 0; r < regions.size(); ++r)
+		if(! regions[r]->hasSpans())
+			return false;
+	return true;
+}
+
+//! Functor to compute the overlaps of the regions of pairs of images, each pair by a thread
+/*! Without derotation, if the regions of the 2 images have their spans, only the spans of the candidate pairs are compared */
+class PairsOverlapper
+{
+	private :
+		const vector<RunLengthColorMap*>& images;
+		const vector<vector<Region*> >& regions;
+		const vector<RegionBoxIndex>& boxIndexes;
+		const vector<pair<unsigned, unsigned> >& imagePairs;
+		const bool derotate;
+		vector<vector<RegionOverlap> >& overlaps;
+		vector<unsigned long>& numberComparedPairs;
+
+	public :
+		PairsOverlapper(const vector<RunLengthColorMap*>& images, const vector<vector<Region*> >& regions, const vector<RegionBoxIndex>& boxIndexes, const vector<pair<unsigned, unsigned> >& imagePairs, const bool derotate, vector<vector<RegionOverlap> >& overlaps, vector<unsigned long>& numberComparedPairs)
+		:images(images), regions(regions), boxIndexes(boxIndexes), imagePairs(imagePairs), derotate(derotate), overlaps(overlaps), numberComparedPairs(numberComparedPairs)
+		{}
+
+		void operator()(const unsigned begin, const unsigned end)
+		{
+			vector<unsigned> pairOverlaps;
+			vector<unsigned> candidates;
+			for (unsigned p = begin; p < end; ++p)
+			{
+				const unsigned s1 = imagePairs[p].first;
+				const unsigned s2 = imagePairs[p].second;
+				const bool compareSpans = ! derotate && haveSpans(regions[s1]) && haveSpans(regions[s2]);
+				if(! compareSpans)
+					overlay(images[s1], regions[s1], images[s2], regions[s2], derotate, pairOverlaps);
+				ColorMap geometry1(images[s1]->getWCS()), geometry2(images[s2]->getWCS());
+				for (unsigned r1 = 0; r1 < regions[s1].size(); ++r1)
+				{
+					// Only the regions of s2 whose box intersects the box of r1 in s2 can overlap with r1
+					PixLoc boxmin, boxmax;
+					trackingBox(&geometry1, regions[s1][r1], &geometry2, derotate, boxmin, boxmax);
+					boxIndexes[s2].candidates(boxmin, boxmax, candidates);
+					numberComparedPairs[p] += candidates.size();
+					for (unsigned c = 0; c < candidates.size(); ++c)
+					{
+						const unsigned r2 = candidates[c];
+						const unsigned pixels = compareSpans ? overlay(regions[s1][r1], regions[s2][r2]) : pairOverlaps[r1 * regions[s2].size() + r2];
+						if(pixels > 0)
+							overlaps[p].push_back(RegionOverlap(r1, r2, pixels));
+					}
+				}
+			}
+		}
+};
+
+// Compute the overlaps of the regions of several pairs of images in parallel
+void overlays(const vector<RunLengthColorMap*>& images, const vector<vector<Region*> >& regions, const vector<RegionBoxIndex>& boxIndexes, const vector<pair<unsigned, unsigned> >& imagePairs, const bool derotate, vector<vector<RegionOverlap> >& overlaps, unsigned long& numberComparedPairs)
+{
+	overlaps.assign(imagePairs.size(), vector<RegionOverlap>());
+	// Each pair has its own count, so that the threads do not share it
+	vector<unsigned long> pairComparedPairs(imagePairs.size(), 0);
+	PairsOverlapper overlapper(images, regions, boxIndexes, imagePairs, derotate, overlaps, pairComparedPairs);
+	parallel_for(imagePairs.size(), overlapper);
+	numberComparedPairs = 0;
+	for (unsigned p = 0; p < imagePairs.size(); ++p)
+		numberComparedPairs += pairComparedPairs[p];
+}
+
+// Compute the number of pixels common to 2 regions from 2 run length maps
+unsigned overlay(const RunLengthColorMap* image1, const Region* region1, const RunLengthColorMap* image2, const Region* region2)
+{
+	if(region1->hasSpans() && region2->hasSpans())
+		return overlay(region1, region2);
+	
+	ColorType setValue1 = image1->pixel(region1->FirstPixel());
+	ColorType setValue2 = image2->pixel(region2->FirstPixel());
+	
+	// We only compare the rows common to the 2 boxes of the regions
+	unsigned Ymin = region1->Boxmin().y > region2->Boxmin().y ? region1->Boxmin().y : region2->Boxmin().y;
+	unsigned Ymax = region1->Boxmax().y < region2->Boxmax().y ? region1->Boxmax().y : region2->Boxmax().y;
+	if(Ymin > Ymax)
+		return 0;
+	return image1->intersection(setValue1, image2, setValue2, Ymin, Ymax + 1);
+}
+
+//! A node being colored by RegionGraph::node::colorize, with the parent it is at and its biggest parent so far
+class ColorizeFrame
+{
+	public :
+		RegionGraph::node* node;
+		RegionGraph::node::const_iterator parent;
+		RegionGraph::node::const_iterator biggestInEdge;
+
+		ColorizeFrame(RegionGraph::node* node)
+		:node(node), parent(node->in_begin()), biggestInEdge(node->in_begin()){}
+};
+
+// Color a node and its uncolored ancestors
+// The nodes are colored in the same order as a recursion into the parents, but with an explicit stack so that long chains of regions do not overflow the call stack
 void RegionGraph::node::colorize()
 {
 	//If I'm already colored than I am fine
 	if(region->Color() != 0)
 		return;
 
-	// I need all my parents to have their color
-	RegionGraph::node::const_iterator biggestInEdge = in_begin();
-	for (RegionGraph::node::const_iterator it = in_begin(); it != in_end(); ++it)
+	vector<ColorizeFrame> stack(1, ColorizeFrame(this));
+	while(! stack.empty())
 	{
-		//Carefull there is recursion here
-		it->from->colorize();
-		// We search for the biggest parent
-		if(it->weight > biggestInEdge->weight)
-			biggestInEdge = it;
-		// We inherit the firstObservationTime of my parents
-		if(it->from->get_region()->FirstObservationTime() < region->FirstObservationTime())
-			region->setFirstObservationTime(it->from->get_region()->FirstObservationTime());
+		ColorizeFrame& frame = stack.back();
+		Region* nodeRegion = frame.node->get_region();
+		if(frame.parent != frame.node->in_end())
+		{
+			// I need all my parents to have their color, the parent is colored before I look at it
+			node* parent = frame.parent->from;
+			if(parent->get_region()->Color() == 0)
+			{
+				stack.push_back(ColorizeFrame(parent));
+				continue;
+			}
+			// We search for the biggest parent
+			if(frame.parent->weight > frame.biggestInEdge->weight)
+				frame.biggestInEdge = frame.parent;
+			// We inherit the firstObservationTime of my parents
+			if(parent->get_region()->FirstObservationTime() < nodeRegion->FirstObservationTime())
+				nodeRegion->setFirstObservationTime(parent->get_region()->FirstObservationTime());
+			++frame.parent;
+			continue;
+		}
 
+		//Either I am the only child of my biggest parent, or I am his biggest Son
+		if(frame.biggestInEdge != frame.node->in_end() && nodeRegion == frame.biggestInEdge->from->biggestSon()->get_region())
+		{
+			nodeRegion->setColor(frame.biggestInEdge->from->get_region()->Color());
+			nodeRegion->setFirstObservationTime(frame.biggestInEdge->from->get_region()->FirstObservationTime());
+		}
+		//There was a split or a merge, or I have no parents
+		else
+			nodeRegion->setColor(++newColor);
+		stack.pop_back();
 	}
-	//Either I am the only child of my biggest parent, or I am his biggest Son
-	if(biggestInEdge != in_end() && region == biggestInEdge->from->biggestSon()->get_region())
-	{
-		region->setColor(biggestInEdge->from->get_region()->Color());
-		region->setFirstObservationTime(biggestInEdge->from->get_region()->FirstObservationTime());
-	}
-	//There was a split or a merge, or I have no parents
-	else
-		region->setColor(++newColor);
 }
 
 
@@ -259,25 +582,25 @@ inline vector<unsigned> imageOrder(const vector<ColorMap*>& images)
 
 void recolorFromRegions(ColorMap* image, const vector<Region*>& regions)
 {
-	map<ColorType,ColorType> colorTransfo;
+	// The pixels that do not belong to a region get the color 0
+	ColorLUT colorTransfo(0);
 	for (unsigned r = 0; r < regions.size(); ++r)
 	{
-		colorTransfo[image->pixel(regions[r]->FirstPixel())] = regions[r]->Color();
+		colorTransfo.set(image->pixel(regions[r]->FirstPixel()), regions[r]->Color());
 	}
+	#if defined EXTRA_SAFE
 	for (unsigned j = 0; j < image->NumberPixels(); ++j)
 	{
-		if(image->pixel(j) != image->null())
+		if(image->pixel(j) != image->null() && ! colorTransfo.contains(image->pixel(j)))
 		{
-			#if defined EXTRA_SAFE
-				if(colorTransfo.count(image->pixel(j)) == 0)
-				{
-					cerr<<"Error: trying to colorize image, pixel has no corresponding region"<<endl;
-					exit (EXIT_FAILURE);
-				}
-			#endif
-			image->pixel(j) = colorTransfo[image->pixel(j)];
+			cerr<<"Error: trying to colorize image, pixel has no corresponding region"<<endl;
+			exit (EXIT_FAILURE);
 		}
 	}
+	#endif
+	// The null pixels stay null
+	colorTransfo.set(image->null(), image->null());
+	colorTransfo.apply(image->row(0), image->Xaxes(), image->Yaxes());
 }
 
 FitsFile& writeTrackingRelations(FitsFile& file, const vector<Region*>& regions, const RegionGraph& tracking_graph, const Real pixel_area)
@@ -20,6 +20,7 @@
 #include "ColorMap.h"
 #include "Region.h"
 #include "gradient.h"
+#include "RegionBoxIndex.h"
 
 extern std::string filenamePrefix;
 extern ColorType newColor;
@@ -153,9 +154,42 @@ std::vector<unsigned> imageOrder(const std::vector<ColorMap*>& images);
 // Compute the number of pixels common to 2 regions from 2 images, with derotation
 unsigned overlay_derotate(ColorMap* image1, const Region* region1, ColorMap* image2, const Region* region2);
 
+// Compute the box of the pixels of image2 that can be common with region1 of image1, with or without derotation
+// Only the regions of image2 whose box intersects it need to be compared with region1 (see RegionBoxIndex)
+void trackingBox(ColorMap* image1, const Region* region1, ColorMap* image2, const bool derotate, PixLoc& boxmin, PixLoc& boxmax);
+
+// Compute the number of pixels common to 2 regions from their spans, row by row (see getRegions)
+// The regions must be from maps of the same geometry, the time is proportional to their number of spans
+unsigned overlay(const Region* region1, const Region* region2);
+
 // Compute the number of pixels common to 2 regions from 2 images
+// If both regions have their spans, only the spans are compared
 unsigned overlay(ColorMap* image1, const Region* region1, ColorMap* image2, const Region* region2);
 
+//! The number of pixels common to the region r1 of an image and the region r2 of another image
+class RegionOverlap
+{
+	public :
+		unsigned r1, r2, pixels;
+
+		RegionOverlap(const unsigned r1 = 0, const unsigned r2 = 0, const unsigned pixels = 0)
+		:r1(r1), r2(r2), pixels(pixels){}
+};
+
+// Compute the overlaps of the regions of several pairs of run length maps in parallel, each pair by a thread
+// For each pair (s1, s2) of imagePairs, overlaps[p] has the pairs of regions of s1 and s2 with common pixels, ordered by r1 and then r2
+// Only the regions of s2 whose box intersects the tracking box of r1 are compared (see trackingBox), the number of pairs of regions compared is returned in numberComparedPairs
+void overlays(const std::vector<RunLengthColorMap*>& images, const std::vector<std::vector<Region*> >& regions, const std::vector<RegionBoxIndex>& boxIndexes, const std::vector<std::pair<unsigned, unsigned> >& imagePairs, const bool derotate, std::vector<std::vector<RegionOverlap> >& overlaps, unsigned long& numberComparedPairs);
+
+// Compute the number of pixels common to 2 regions from 2 run length maps
+// If both regions have their spans, only the spans are compared
+unsigned overlay(const RunLengthColorMap* image1, const Region* region1, const RunLengthColorMap* image2, const Region* region2);
+
+// Compute the number of pixels common to each pair of regions from 2 run length maps, with or without derotation, in a single scan of the runs of image2
+// The number of pixels common to regions1[r1] and regions2[r2] is overlaps[r1 * regions2.size() + r2], it is the same than with overlay_derotate or overlay
+// With derotation, each pixel of the regions of image2 is projected into image1 once for all the pairs
+void overlay(const RunLengthColorMap* image1, const std::vector<Region*>& regions1, const RunLengthColorMap* image2, const std::vector<Region*>& regions2, const bool derotate, std::vector<unsigned>& overlaps);
+
 // Output a graph in the dot format
 void ouputGraph(const RegionGraph& g, const std::vector<std::vector<Region*> >& regions, const std::string graphName, bool isColored = true);
 
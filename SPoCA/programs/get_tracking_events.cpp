@@ -0,0 +1,504 @@
+//! This Program computes the lifespans, the split and merge events and the time series of tracked regions.
+/*!
+@page get_tracking_events get_tracking_events.x
+
+Version: 3.0
+
+Author: Benjamin Mampaey, benjamin.mampaey@sidc.be
+
+@section usage Usage
+<tt> bin/get_tracking_events.x [-option optionvalue ...]  mapFile [ mapFile ... ] </tt>
+
+@param mapFile	Path to a tracked map, with its table of regions and its table of tracking relations (see @ref tracking).
+
+global parameters:
+
+@param help	Print a help message and exit.
+<BR>If you pass the value doxygen, the help message will follow the doxygen convention.
+<BR>If you pass the value config, the help message will write a configuration file template.
+
+@param config	Program option configuration file.
+
+@param binary	Set this flag if you want the tables to be also written as binary tables in a fits file.
+
+@param output	The name of the directory for the output files.
+
+@param regionTableName	The name of the region table Hdu
+
+@param separator	The separator to put between columns.
+
+The tables of the maps are read in parallel if cfitsio is reentrant, and the tracking graph of the regions is rebuilt from the tracking relations.
+The regions of a map with the same tracked color (e.g. the fragments of a region) are taken as a single region, like in the tracking relations.
+The following files are written in the output directory:
+ - tracking_lifespans.csv: for each tracked color, the first and last observation dates, the lifespan as a timedelta (e.g. 1 days 02:00:00, like write_regions_lifespan_to_csv.py) and in seconds, and the number of observations
+ - tracking_events.csv: the split and merge events, i.e. the tracking relations between 2 regions of different colors
+ - tracking_time_series.csv: for each tracked color and each observation, the number of regions, the number of pixels and the deprojected area
+ - tracking_events.fits: the same tables as the binary tables Lifespans, Events and TimeSeries, if binary is set
+
+See @ref Compilation_Options for constants and parameters for SPoCA at compilation time.
+
+*/
+
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <iomanip>
+#include <ctime>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+#include "../classes/tools.h"
+#include "../classes/constants.h"
+#include "../classes/mainutilities.h"
+#include "../classes/ArgParser.h"
+
+#include "../classes/Region.h"
+#include "../classes/trackable.h"
+#include "../classes/TrackingRelation.h"
+#include "../classes/FitsFile.h"
+#include "../classes/parallel.h"
+
+using namespace std;
+
+//! Prefix name for outputing intermediate result files
+string filenamePrefix;
+
+//! The regions and the tracking relations read from the tables of a map
+class MapTables
+{
+	public :
+		//! The error message if the tables could not be read
+		string error;
+
+		//! The regions, with their tracked color
+		vector<Region*> regions;
+
+		//! The number of pixels and the deprojected area of the regions, if the table has them
+		vector<unsigned> numberPixels;
+		vector<Real> areaDeprojected;
+
+		//! The columns of the table of tracking relations
+		vector<string> pastDates, presentDates;
+		vector<ColorType> pastColors, presentColors;
+		vector<int> overlapNumberPixels;
+		vector<Real> overlapAreaProjected;
+};
+
+//! Functor to read the tables of the maps, each map by a thread
+class MapTablesReader
+{
+	private :
+		const deque<string>& filenames;
+		const string regionTableName;
+		vector<MapTables>& tables;
+
+	public :
+		MapTablesReader(const deque<string>& filenames, const string& regionTableName, vector<MapTables>& tables)
+		:filenames(filenames), regionTableName(regionTableName), tables(tables)
+		{}
+
+		void operator()(const unsigned begin, const unsigned end)
+		{
+			for (unsigned f = begin; f < end; ++f)
+			{
+				MapTables& table = tables[f];
+				try
+				{
+					FitsFile file(filenames[f]);
+					if(! file.has(regionTableName))
+					{
+						table.error = "no table " + regionTableName;
+						continue;
+					}
+					file.moveTo(regionTableName);
+					readRegions(file, table.regions, true);
+					if(file.find_column("NUMBER_PIXELS"))
+						file.readColumn("NUMBER_PIXELS", table.numberPixels);
+					if(file.find_column("AREA_DEPROJECTED"))
+						file.readColumn("AREA_DEPROJECTED", table.areaDeprojected);
+					table.numberPixels.resize(table.regions.size(), 0);
+					table.areaDeprojected.resize(table.regions.size(), 0);
+
+					// The first map of a tracking has no relations
+					if(file.has("TrackingRelations"))
+					{
+						file.moveTo("TrackingRelations");
+						file.readColumn("PAST_DATE_OBS", table.pastDates);
+						file.readColumn("PAST_COLOR", table.pastColors);
+						file.readColumn("PRESENT_DATE_OBS", table.presentDates);
+						file.readColumn("PRESENT_COLOR", table.presentColors);
+						file.readColumn("OVERLAP_NUMBER_PIXELS", table.overlapNumberPixels);
+						file.readColumn("OVERLAP_AREA_PROJECTED", table.overlapAreaProjected);
+					}
+					if(! file.isGood())
+						table.error = "error reading the tables";
+				}
+				catch (const exception& error)
+				{
+					table.error = error.what();
+				}
+			}
+		}
+};
+
+//! Comparison of the maps by the observation time of their regions
+class MapTablesTimeOrder
+{
+	private :
+		const vector<MapTables>& tables;
+
+	public :
+		MapTablesTimeOrder(const vector<MapTables>& tables)
+		:tables(tables)
+		{}
+
+		bool operator()(const unsigned a, const unsigned b) const
+		{
+			return tables[a].regions.front()->ObservationTime() < tables[b].regions.front()->ObservationTime();
+		}
+};
+
+//! The lifespan of a tracked color
+class Lifespan
+{
+	public :
+		const Region* first;
+		const Region* last;
+		unsigned numberObservations;
+
+		Lifespan(const Region* region = NULL)
+		:first(region), last(region), numberObservations(0)
+		{}
+};
+
+//! The regions of a tracked color in a map
+class Observation
+{
+	public :
+		const Region* region;
+		unsigned numberRegions, numberPixels;
+		Real areaDeprojected;
+
+		Observation()
+		:region(NULL), numberRegions(0), numberPixels(0), areaDeprojected(0)
+		{}
+};
+
+//! Routine that returns a number of seconds as a timedelta, in the format of pandas
+string timedelta(const unsigned seconds)
+{
+	ostringstream out;
+	out<<seconds / 86400<<" days "<<setfill('0')<<setw(2)<<(seconds % 86400) / 3600<<":"<<setw(2)<<(seconds % 3600) / 60<<":"<<setw(2)<<seconds % 60;
+	return out.str();
+}
+
+//! Routine that returns the relation between the 2 regions of an edge of the tracking graph
+/*!
+A region that has the color of its parent follows it. Otherwise the color of the region changed because of a merge, if it has several parents, or because of a split of its parent.
+The parents of a region are all in the table of tracking relations of its map, so its number of in edges is exact.
+*/
+TrackingRelation trackingRelation(const RegionGraph::edge& e)
+{
+	const ColorType pastColor = e.from->get_region()->Color();
+	const ColorType presentColor = e.to->get_region()->Color();
+	if(pastColor == presentColor)
+		return TrackingRelation(pastColor, "follows", presentColor);
+	else if(e.to->in_end() - e.to->in_begin() > 1)
+		return TrackingRelation(pastColor, "merges_from", presentColor);
+	else
+		return TrackingRelation(pastColor, "splits_from", presentColor);
+}
+
+int main(int argc, const char **argv)
+{
+	cout<<setiosflags(ios::fixed);
+
+	// We declare our program description
+	string programDescription = "This Program computes the lifespans, the split and merge events and the time series of tracked regions.";
+	programDescription+="\nVersion: 3.0";
+	programDescription+="\nAuthor: Benjamin Mampaey, benjamin.mampaey@sidc.be";
+
+	programDescription+="\nCompiled on "  __DATE__  " with options :";
+	programDescription+="\nNUMBERCHANNELS: " + toString(NUMBERCHANNELS);
+	#if defined DEBUG
+	programDescription+="\nDEBUG: ON";
+	#endif
+	#if defined EXTRA_SAFE
+	programDescription+="\nEXTRA_SAFE: ON";
+	#endif
+	#if defined VERBOSE
+	programDescription+="\nVERBOSE: ON";
+	#endif
+	programDescription+="\nEUVPixelType: " + string(typeid(EUVPixelType).name());
+	programDescription+="\nReal: " + string(typeid(Real).name());
+
+	// We define our program parameters
+	ArgParser args(programDescription);
+
+	args["config"] = ArgParser::ConfigurationFile('C');
+	args["help"] = ArgParser::Help('h');
+
+	args["regionTableName"] = ArgParser::Parameter("Regions", 'H',"The name of the region table Hdu");
+	args["separator"] = ArgParser::Parameter(',', 's', "The separator to put between columns.");
+	args["binary"] = ArgParser::Parameter(false, 'b', "Set this flag if you want the tables to be also written as binary tables in a fits file.");
+	args["output"] = ArgParser::Parameter(".", 'O', "The name of the directory for the output files.");
+	args["mapFile"] = ArgParser::RemainingPositionalParameters("Path to a tracked map, with its table of regions and its table of tracking relations.", 1);
+
+	// We parse the arguments
+	try
+	{
+		args.parse(argc, argv);
+	}
+	catch ( const invalid_argument& error)
+	{
+		cerr<<"Error : "<<error.what()<<endl;
+		cerr<<args.help_message(argv[0])<<endl;
+		return EXIT_FAILURE;
+	}
+
+	// We setup the output directory
+	string outputDirectory = args["output"];
+	if (! isDir(outputDirectory))
+	{
+		cerr<<"Error : "<<outputDirectory<<" is not a directory!"<<endl;
+		return EXIT_FAILURE;
+	}
+	string separator = args["separator"];
+
+	// We read the tables of all the maps in parallel
+	// The files can only be read by several threads if cfitsio was built reentrant, otherwise they are read one after the other
+	deque<string> mapsFilenames = args.RemainingPositionalArguments();
+	vector<MapTables> tables(mapsFilenames.size());
+	MapTablesReader reader(mapsFilenames, args["regionTableName"], tables);
+	if(fits_is_reentrant())
+		parallel_for(mapsFilenames.size(), reader);
+	else
+		reader(0, mapsFilenames.size());
+
+	// We order the maps by time, the maps without regions are skipped
+	vector<unsigned> order;
+	for (unsigned f = 0; f < tables.size(); ++f)
+	{
+		if(! tables[f].error.empty())
+			cerr<<"Error : could not read the tables of "<<mapsFilenames[f]<<" : "<<tables[f].error<<endl;
+		else if(! tables[f].regions.empty())
+			order.push_back(f);
+	}
+	stable_sort(order.begin(), order.end(), MapTablesTimeOrder(tables));
+
+	// We create the nodes of the tracking graph, a region is identified by its observation time and its color
+	// The tracking relations do not tell apart the regions of a map with the same color, so they have a single node, the one of their first region
+	RegionGraph tracking_graph;
+	map<pair<time_t, ColorType>, Region*> regionsByColor;
+	unsigned numberSharedColors = 0;
+	for (unsigned o = 0; o < order.size(); ++o)
+	{
+		const MapTables& table = tables[order[o]];
+		for (unsigned r = 0; r < table.regions.size(); ++r)
+		{
+			Region*& region = regionsByColor[make_pair(table.regions[r]->ObservationTime(), table.regions[r]->Color())];
+			if(region == NULL)
+			{
+				region = table.regions[r];
+				tracking_graph.add_node(region);
+			}
+			else
+			{
+				++numberSharedColors;
+			}
+		}
+	}
+	if(numberSharedColors > 0)
+	{
+		cerr<<"Warning: "<<numberSharedColors<<" regions have the color of another region of their map, they are counted as a single region in the events."<<endl;
+	}
+
+	// We create the edges from the tracking relations
+	// The past regions of maps that were not given are added to the graph, so that the number of parents of a region is exact
+	// The relations between regions with the same colors as other regions are added to the same edge, so that a region has one parent per color
+	vector<Region*> pastRegions;
+	map<pair<const Region*, const Region*>, pair<int, Real> > overlaps;
+	vector<pair<Region*, Region*> > edges;
+	for (unsigned o = 0; o < order.size(); ++o)
+	{
+		const MapTables& table = tables[order[o]];
+		for (unsigned e = 0; e < table.pastColors.size(); ++e)
+		{
+			pair<time_t, ColorType> past(iso2ctime(table.pastDates[e]), table.pastColors[e]);
+			pair<time_t, ColorType> present(iso2ctime(table.presentDates[e]), table.presentColors[e]);
+			if(regionsByColor.count(present) == 0)
+			{
+				cerr<<"Error : the region of color "<<present.second<<" at "<<table.presentDates[e]<<" is not in the table of regions of "<<mapsFilenames[order[o]]<<endl;
+				continue;
+			}
+			if(regionsByColor.count(past) == 0)
+			{
+				pastRegions.push_back(new Region(past.first, 0, past.second));
+				tracking_graph.add_node(pastRegions.back());
+				regionsByColor[past] = pastRegions.back();
+			}
+			pair<Region*, Region*> edge(regionsByColor[past], regionsByColor[present]);
+			map<pair<const Region*, const Region*>, pair<int, Real> >::iterator overlap = overlaps.find(edge);
+			if(overlap == overlaps.end())
+			{
+				overlap = overlaps.insert(make_pair(edge, make_pair(0, Real(0)))).first;
+				edges.push_back(edge);
+			}
+			overlap->second.first += table.overlapNumberPixels[e];
+			overlap->second.second += table.overlapAreaProjected[e];
+		}
+	}
+	for (unsigned e = 0; e < edges.size(); ++e)
+	{
+		tracking_graph.add_edge(tracking_graph.get_node(edges[e].first), tracking_graph.get_node(edges[e].second), overlaps[edges[e]].first);
+	}
+
+	// We compute the lifespans and the time series of the colors
+	map<ColorType, Lifespan> lifespans;
+	map<ColorType, map<time_t, Observation> > timeSeries;
+	for (unsigned o = 0; o < order.size(); ++o)
+	{
+		const MapTables& table = tables[order[o]];
+		for (unsigned r = 0; r < table.regions.size(); ++r)
+		{
+			const Region* region = table.regions[r];
+			map<ColorType, Lifespan>::iterator lifespan = lifespans.find(region->Color());
+			if(lifespan == lifespans.end())
+				lifespan = lifespans.insert(make_pair(region->Color(), Lifespan(region))).first;
+			if(region->FirstObservationTime() < lifespan->second.first->FirstObservationTime())
+				lifespan->second.first = region;
+			if(region->ObservationTime() > lifespan->second.last->ObservationTime())
+				lifespan->second.last = region;
+
+			Observation& observation = timeSeries[region->Color()][region->ObservationTime()];
+			if(observation.numberRegions == 0)
+			{
+				observation.region = region;
+				++lifespan->second.numberObservations;
+			}
+			++observation.numberRegions;
+			observation.numberPixels += table.numberPixels[r];
+			observation.areaDeprojected += table.areaDeprojected[r];
+		}
+	}
+
+	// We write the lifespans
+	vector<ColorType> lifespanColors;
+	vector<string> lifespanFirstDates, lifespanLastDates, lifespanDurations;
+	vector<unsigned> lifespanSeconds, lifespanObservations;
+	for (map<ColorType, Lifespan>::const_iterator l = lifespans.begin(); l != lifespans.end(); ++l)
+	{
+		lifespanColors.push_back(l->first);
+		lifespanFirstDates.push_back(l->second.first->FirstObservationDate());
+		lifespanLastDates.push_back(l->second.last->ObservationDate());
+		lifespanSeconds.push_back(unsigned(difftime(l->second.last->ObservationTime(), l->second.first->FirstObservationTime())));
+		lifespanDurations.push_back(timedelta(lifespanSeconds.back()));
+		lifespanObservations.push_back(l->second.numberObservations);
+	}
+	ofstream lifespansFile(makePath(outputDirectory, "tracking_lifespans.csv").c_str());
+	lifespansFile<<"TRACKED_COLOR"<<separator<<"FIRST_DATE_OBS"<<separator<<"LAST_DATE_OBS"<<separator<<"LIFESPAN"<<separator<<"LIFESPAN_SECONDS"<<separator<<"NUMBER_OBSERVATIONS"<<endl;
+	for (unsigned l = 0; l < lifespanColors.size(); ++l)
+		lifespansFile<<lifespanColors[l]<<separator<<lifespanFirstDates[l]<<separator<<lifespanLastDates[l]<<separator<<lifespanDurations[l]<<separator<<lifespanSeconds[l]<<separator<<lifespanObservations[l]<<endl;
+
+	// We write the split and merge events, in the order of the tracking relations
+	vector<string> eventTypes, eventPastDates, eventPresentDates;
+	vector<ColorType> eventPastColors, eventPresentColors;
+	vector<int> eventOverlapNumberPixels;
+	vector<Real> eventOverlapAreaProjected;
+	for (unsigned o = 0; o < order.size(); ++o)
+	{
+		const MapTables& table = tables[order[o]];
+		for (unsigned r = 0; r < table.regions.size(); ++r)
+		{
+			// The regions that share the node of another region have no node
+			if(regionsByColor[make_pair(table.regions[r]->ObservationTime(), table.regions[r]->Color())] != table.regions[r])
+				continue;
+			const RegionGraph::node* n = tracking_graph.get_node(table.regions[r]);
+			for (RegionGraph::node::const_iterator it = n->in_begin(); it != n->in_end(); ++it)
+			{
+				TrackingRelation event = trackingRelation(*it);
+				if(event.type == "follows")
+					continue;
+				eventTypes.push_back(event.type);
+				eventPastDates.push_back(it->from->get_region()->ObservationDate());
+				eventPastColors.push_back(event.past_color);
+				eventPresentDates.push_back(it->to->get_region()->ObservationDate());
+				eventPresentColors.push_back(event.present_color);
+				eventOverlapNumberPixels.push_back(it->weight);
+				eventOverlapAreaProjected.push_back(overlaps[make_pair(it->from->get_region(), it->to->get_region())].second);
+			}
+		}
+	}
+	ofstream eventsFile(makePath(outputDirectory, "tracking_events.csv").c_str());
+	eventsFile<<"TYPE"<<separator<<"PAST_DATE_OBS"<<separator<<"PAST_COLOR"<<separator<<"PRESENT_DATE_OBS"<<separator<<"PRESENT_COLOR"<<separator<<"OVERLAP_NUMBER_PIXELS"<<separator<<"OVERLAP_AREA_PROJECTED"<<endl;
+	for (unsigned e = 0; e < eventTypes.size(); ++e)
+		eventsFile<<eventTypes[e]<<separator<<eventPastDates[e]<<separator<<eventPastColors[e]<<separator<<eventPresentDates[e]<<separator<<eventPresentColors[e]<<separator<<eventOverlapNumberPixels[e]<<separator<<eventOverlapAreaProjected[e]<<endl;
+
+	// We write the time series of the colors
+	vector<ColorType> seriesColors;
+	vector<string> seriesDates;
+	vector<unsigned> seriesNumberRegions, seriesNumberPixels;
+	vector<Real> seriesAreaDeprojected;
+	for (map<ColorType, map<time_t, Observation> >::const_iterator c = timeSeries.begin(); c != timeSeries.end(); ++c)
+	{
+		for (map<time_t, Observation>::const_iterator t = c->second.begin(); t != c->second.end(); ++t)
+		{
+			seriesColors.push_back(c->first);
+			seriesDates.push_back(t->second.region->ObservationDate());
+			seriesNumberRegions.push_back(t->second.numberRegions);
+			seriesNumberPixels.push_back(t->second.numberPixels);
+			seriesAreaDeprojected.push_back(t->second.areaDeprojected);
+		}
+	}
+	ofstream seriesFile(makePath(outputDirectory, "tracking_time_series.csv").c_str());
+	seriesFile<<"TRACKED_COLOR"<<separator<<"DATE_OBS"<<separator<<"NUMBER_REGIONS"<<separator<<"NUMBER_PIXELS"<<separator<<"AREA_DEPROJECTED"<<endl;
+	for (unsigned s = 0; s < seriesColors.size(); ++s)
+		seriesFile<<seriesColors[s]<<separator<<seriesDates[s]<<separator<<seriesNumberRegions[s]<<separator<<seriesNumberPixels[s]<<separator<<seriesAreaDeprojected[s]<<endl;
+
+	// We write the same tables as binary tables, each column is written at once
+	if(args["binary"])
+	{
+		FitsFile file(makePath(outputDirectory, "tracking_events.fits"), FitsFile::overwrite);
+		file.writeTable("Lifespans");
+		file.writeColumn("TRACKED_COLOR", lifespanColors);
+		file.writeColumn("FIRST_DATE_OBS", lifespanFirstDates);
+		file.writeColumn("LAST_DATE_OBS", lifespanLastDates);
+		file.writeColumn("LIFESPAN", lifespanDurations);
+		file.writeColumn("LIFESPAN_SECONDS", lifespanSeconds);
+		file.writeColumn("NUMBER_OBSERVATIONS", lifespanObservations);
+
+		file.writeTable("Events");
+		file.writeColumn("TYPE", eventTypes);
+		file.writeColumn("PAST_DATE_OBS", eventPastDates);
+		file.writeColumn("PAST_COLOR", eventPastColors);
+		file.writeColumn("PRESENT_DATE_OBS", eventPresentDates);
+		file.writeColumn("PRESENT_COLOR", eventPresentColors);
+		file.writeColumn("OVERLAP_NUMBER_PIXELS", eventOverlapNumberPixels);
+		file.writeColumn("OVERLAP_AREA_PROJECTED", eventOverlapAreaProjected);
+
+		file.writeTable("TimeSeries");
+		file.writeColumn("TRACKED_COLOR", seriesColors);
+		file.writeColumn("DATE_OBS", seriesDates);
+		file.writeColumn("NUMBER_REGIONS", seriesNumberRegions);
+		file.writeColumn("NUMBER_PIXELS", seriesNumberPixels);
+		file.writeColumn("AREA_DEPROJECTED", seriesAreaDeprojected);
+	}
+
+	#if defined VERBOSE
+	cout<<"Regions: "<<regionsByColor.size() - pastRegions.size() + numberSharedColors<<", tracked colors: "<<lifespans.size()<<", split and merge events: "<<eventTypes.size()<<endl;
+	#endif
+
+	for (unsigned f = 0; f < tables.size(); ++f)
+	{
+		for (unsigned r = 0; r < tables[f].regions.size(); ++r)
+			delete tables[f].regions[r];
+	}
+	for (unsigned r = 0; r < pastRegions.size(); ++r)
+		delete pastRegions[r];
+
+	return EXIT_SUCCESS;
+}
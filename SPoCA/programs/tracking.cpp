@@ -25,10 +25,16 @@ global parameters:
 
 @param newColor	The first color to attribute to a new untracked region
 
-@param recolorImages	Set this flag if you want all images to be colored and written to disk.Otherwise only the region table is updated.
+@param recolorImages	Set this flag if you want all images to be colored and written to disk.Otherwise only the region table is updated, and only the runs of pixels of the maps are kept in memory.
 
 @param regionTableName	The name of the region table Hdu
 
+@param remapColors	Set this flag if you want all images to be colored by a table of the new color of each color of the map, applied when the map is read, instead of rewriting the images.
+
+@param stateFile	The path of a tracking state file. If set, the maps are also compared with the recent maps kept in the state, and the state is updated with the new maps.
+The maps must be given in time order across runs: a map that is not after the latest map of the state is not tracked.
+<BR>This allows to track the maps one at a time, only the new maps are read and updated.
+
 @param uncompressed	Set this flag if you want results maps to be uncompressed.
 
 See @ref Compilation_Options for constants and parameters for SPoCA at compilation time.
@@ -43,6 +49,7 @@ See @ref Compilation_Options for constants and parameters for SPoCA at compilati
 #include <iomanip>
 #include <ctime>
 #include <algorithm>
+#include <set>
 
 #include "../classes/tools.h"
 #include "../classes/constants.h"
@@ -50,9 +57,14 @@ See @ref Compilation_Options for constants and parameters for SPoCA at compilati
 #include "../classes/ArgParser.h"
 
 #include "../classes/ColorMap.h"
+#include "../classes/RunLengthColorMap.h"
+#include "../classes/buffers.h"
 #include "../classes/Region.h"
 #include "../classes/trackable.h"
+#include "../classes/RegionBoxIndex.h"
+#include "../classes/RegionReachability.h"
 #include "../classes/TrackingRelation.h"
+#include "../classes/TrackingState.h"
 #include "../classes/FitsFile.h"
 #include "../classes/Header.h"
 
@@ -92,9 +104,11 @@ int main(int argc, const char **argv)
 	
 	args["newColor"] = ArgParser::Parameter(0, 'n', "The first color to attribute to a new untracked region");
 	args["maxDeltaT"] = ArgParser::Parameter(3600, 'd',"The maximal number of seconds between 2 tracked regions");
-	args["recolorImages"] = ArgParser::Parameter(false, 'A', "Set this flag if you want all images to be colored and written to disk.Otherwise only the region table is updated.");
+	args["recolorImages"] = ArgParser::Parameter(false, 'A', "Set this flag if you want all images to be colored and written to disk.Otherwise only the region table is updated, and only the runs of pixels of the maps are kept in memory.");
 	args["derotate"] = ArgParser::Parameter(true, 'D', "Set this to false if you dont want images to be derotated before comparison.");
 	args["regionTableName"] = ArgParser::Parameter("Regions", 'H',"The name of the region table Hdu");
+	args["remapColors"] = ArgParser::Parameter(false, 'R', "Set this flag if you want all images to be colored by a table of the new color of each color of the map, applied when the map is read, instead of rewriting the images.");
+	args["stateFile"] = ArgParser::Parameter("", 's', "The path of a tracking state file. If set, the maps are also compared with the recent maps kept in the state, and the state is updated with the new maps.\nThis allows to track the maps one at a time, only the new maps are read and updated.\nThe maps must be given in time order across runs: a map that is not after the latest map of the state is not tracked.");
 	args["uncompressed"] = ArgParser::Parameter(false, 'u', "Set this flag if you want results maps to be uncompressed.");
 	
 	args["fitsFile"] = ArgParser::RemainingPositionalParameters("Path of a fits files containing a maps of regions to track.");
@@ -116,6 +130,7 @@ int main(int argc, const char **argv)
 	// We get the maps, regions and colors from the fits files
 	vector<vector<Region*> > regions;
 	vector<ColorMap*> images;
+	vector<RunLengthColorMap*> runMaps;
 	deque<string> imagesFilenames = args.RemainingPositionalArguments();
 	for (unsigned s = 0; s < imagesFilenames.size(); ++s)
 	{
@@ -146,7 +161,8 @@ int main(int argc, const char **argv)
 		}
 		else // We extract the regions from the map
 		{
-			tmp_regions = getRegions(image);
+			// Without derotation, the regions keep their spans of pixels, so that only the spans are compared
+			tmp_regions = getRegions(image, ! bool(args["derotate"]));
 			if(! (image->getHeader().has("TRACKED") && image->getHeader().get<bool>("TRACKED")))
 			{
 				for (unsigned r = 0; r < tmp_regions.size(); ++r)
@@ -159,6 +175,79 @@ int main(int argc, const char **argv)
 			}
 		}
 		regions.push_back(tmp_regions);
+		
+		// We keep the pixels of the map as runs, so that the memory used is proportional to the area of the regions
+		// The pixels of the image are only needed to recolor it
+		runMaps.push_back(new RunLengthColorMap(image));
+		if(! args["recolorImages"])
+			image->resize(0, 0);
+	}
+	if(! args["recolorImages"])
+	{
+		// The released pixels of the images are not needed anymore
+		clearBufferPool();
+	}
+	
+	unsigned maxDeltaT = args["maxDeltaT"];
+	
+	// We add the maps of the tracking state after the new maps, their regions are already tracked
+	TrackingState previousState;
+	if(args["stateFile"].is_set() && isFile(args["stateFile"]))
+	{
+		if(! previousState.readFits(args["stateFile"]))
+		{
+			return EXIT_FAILURE;
+		}
+		if(previousState.maxDeltaT != maxDeltaT || previousState.derotate != bool(args["derotate"]))
+		{
+			cerr<<"Error : the tracking state "<<args["stateFile"]<<" was made with different maxDeltaT or derotate parameters."<<endl;
+			return EXIT_FAILURE;
+		}
+		newColor = previousState.latestColor > newColor ? previousState.latestColor : newColor;
+		
+		// A new map already in the state was tracked by a previous run, if it was tracked again it would overlap with itself
+		// A new map before the latest map of the state would change the colors of regions whose files are not rewritten, so the maps must arrive in time order
+		set<time_t> stateTimes;
+		time_t latestStateTime = 0;
+		for (unsigned k = 0; k < previousState.maps.size(); ++k)
+		{
+			stateTimes.insert(previousState.maps[k]->ObservationTime());
+			latestStateTime = max(latestStateTime, previousState.maps[k]->ObservationTime());
+		}
+		unsigned numberKeptImages = 0;
+		for (unsigned s = 0; s < images.size(); ++s)
+		{
+			const bool alreadyTracked = stateTimes.count(images[s]->ObservationTime()) > 0;
+			if(alreadyTracked || images[s]->ObservationTime() < latestStateTime)
+			{
+				if(alreadyTracked)
+					cerr<<"Warning: image "<<imagesFilenames[s]<<" is already in the tracking state "<<args["stateFile"]<<", it is not tracked again."<<endl;
+				else
+					cerr<<"Error : image "<<imagesFilenames[s]<<" is before the latest map of the tracking state "<<args["stateFile"]<<", it is not tracked."<<endl;
+				for (unsigned r = 0; r < regions[s].size(); ++r)
+					delete regions[s][r];
+				delete images[s];
+				delete runMaps[s];
+				continue;
+			}
+			images[numberKeptImages] = images[s];
+			runMaps[numberKeptImages] = runMaps[s];
+			regions[numberKeptImages] = regions[s];
+			imagesFilenames[numberKeptImages] = imagesFilenames[s];
+			++numberKeptImages;
+		}
+		images.resize(numberKeptImages);
+		runMaps.resize(numberKeptImages);
+		regions.resize(numberKeptImages);
+		imagesFilenames.resize(numberKeptImages);
+	}
+	const unsigned numberNewImages = images.size();
+	for (unsigned k = 0; k < previousState.maps.size(); ++k)
+	{
+		images.push_back(previousState.maps[k]);
+		runMaps.push_back(previousState.runMaps[k]);
+		regions.push_back(previousState.regions[k]);
+		imagesFilenames.push_back(args["stateFile"] + "[Map_" + toString(k) + "]");
 	}
 	
 	filenamePrefix = images.size() > 0 ? toString(images[0]->ObservationTime()) + "." : "nofiles.";
@@ -180,12 +269,35 @@ int main(int argc, const char **argv)
 
 	//We ordonate the images according to time
 	vector<unsigned> indices = imageOrder(images);
+	
+	// We index the boxes of the regions of each image, to compare only the regions that can overlap
+	vector<RegionBoxIndex> boxIndexes;
+	for (unsigned s = 0; s < regions.size(); ++s)
+	{
+		boxIndexes.push_back(RegionBoxIndex(regions[s]));
+	}
+	
 	// We create the edges of the graph
 	// According to Cis we create an edge between 2 nodes
 	// if their time difference is smaller than some value and
 	// if they overlap and
 	// if there is not already a path between them
-	unsigned maxDeltaT = args["maxDeltaT"];
+	// We keep the ancestors of each region, so that the test of a path does not search the graph
+	RegionReachability reachability(regions, images, indices, maxDeltaT);
+	
+	// The edges between the maps of the state are the ones of the state
+	for (unsigned e = 0; e < previousState.edges.size(); ++e)
+	{
+		const TrackingEdge& edge = previousState.edges[e];
+		unsigned s1 = numberNewImages + edge.fromMap;
+		unsigned s2 = numberNewImages + edge.toMap;
+		tracking_graph.add_edge(tracking_graph.get_node(regions[s1][edge.fromRegion]), tracking_graph.get_node(regions[s2][edge.toRegion]), edge.weight);
+		reachability.add_edge(s1, edge.fromRegion, s2, edge.toRegion);
+	}
+	
+	// We list the pairs of images to compare, in the order the edges are created
+	vector<pair<unsigned, unsigned> > imagePairs;
+	unsigned long numberPairs = 0;
 	for (unsigned d = 1; d < indices.size(); ++d)
 	{
 		for (unsigned i = 0; d + i < indices.size(); ++i)
@@ -198,40 +310,54 @@ int main(int argc, const char **argv)
 			{
 				continue;
 			}
+			// The edges between 2 maps of the state are already known
+			if (s1 >= numberNewImages && s2 >= numberNewImages)
+			{
+				continue;
+			}
 			
 			#if defined DEBUG
 			if(args["derotate"])
 			{
-				SunImage<ColorType>* rotated = images[s1]->shifted_like(images[s2]);
+				ColorMap map1(images[s1]->getWCS()), map2(images[s2]->getWCS());
+				runMaps[s1]->toColorMap(&map1);
+				runMaps[s2]->toColorMap(&map2);
+				SunImage<ColorType>* rotated = map1.shifted_like(&map2);
 				rotated->writeFits("rotated_"+ stripSuffix(stripPath(imagesFilenames[s1])) + "_to_" + stripSuffix(stripPath(imagesFilenames[s2]))+".fits");
 				delete rotated;
 			}
 			#endif
-			for (unsigned r1 = 0; r1 < regions[s1].size(); ++r1)
+			imagePairs.push_back(make_pair(s1, s2));
+			numberPairs += (unsigned long)(regions[s1].size()) * regions[s2].size();
+		}
+	}
+	
+	// We compute the number of pixels common to the regions of all the pairs of images in parallel
+	// Only the regions whose boxes intersect are compared, and each pixel is derotated once per pair of images
+	vector<vector<RegionOverlap> > overlaps;
+	unsigned long numberComparedPairs = 0;
+	overlays(runMaps, regions, boxIndexes, imagePairs, args["derotate"], overlaps, numberComparedPairs);
+	
+	// We create the edges in the order of the pairs, so that the graph does not depend on the number of threads
+	for (unsigned p = 0; p < imagePairs.size(); ++p)
+	{
+		unsigned s1 = imagePairs[p].first;
+		unsigned s2 = imagePairs[p].second;
+		for (unsigned o = 0; o < overlaps[p].size(); ++o)
+		{
+			const RegionOverlap& overlap = overlaps[p][o];
+			if(!reachability.path(s1, overlap.r1, s2, overlap.r2))
 			{
-				for (unsigned r2 = 0; r2 < regions[s2].size(); ++r2)
-				{
-					if(!tracking_graph.get_node(regions[s1][r1])->path(tracking_graph.get_node(regions[s2][r2])))
-					{
-						unsigned intersectPixels = 0;
-						if(args["derotate"])
-						{
-							intersectPixels = overlay_derotate(images[s1], regions[s1][r1], images[s2], regions[s2][r2]);
-						}
-						else
-						{
-							intersectPixels = overlay(images[s1], regions[s1][r1], images[s2], regions[s2][r2]);
-						}
-						if(intersectPixels > 0)
-						{
-							tracking_graph.add_edge(tracking_graph.get_node(regions[s1][r1]), tracking_graph.get_node(regions[s2][r2]), intersectPixels);
-						}
-					}
-				}
-
+				tracking_graph.add_edge(tracking_graph.get_node(regions[s1][overlap.r1]), tracking_graph.get_node(regions[s2][overlap.r2]), overlap.pixels);
+				reachability.add_edge(s1, overlap.r1, s2, overlap.r2);
 			}
 		}
+		// The overlaps of a pair are not needed anymore
+		vector<RegionOverlap>().swap(overlaps[p]);
 	}
+	#if defined VERBOSE
+	cout<<"Pairs of regions compared: "<<numberComparedPairs<<", pruned by their boxes: "<<numberPairs - numberComparedPairs<<endl;
+	#endif
 
 	#if defined DEBUG
 	// We output the graph before tranformation
@@ -255,8 +381,18 @@ int main(int argc, const char **argv)
 	// We set whether we should not compress the maps
 	const int compressed_fits = args["uncompressed"] ? 0 : FitsFile::compress;
 
+	// We update the tracking state with the new maps
+	if(args["stateFile"].is_set())
+	{
+		TrackingState state(images, runMaps, regions, tracking_graph, maxDeltaT, args["derotate"], newColor);
+		if(! state.writeFits(args["stateFile"]))
+		{
+			cerr<<"Error : could not write the tracking state "<<args["stateFile"]<<endl;
+		}
+	}
+	
 	// We update the fits files with the new colors
-	for (unsigned s = 0; s < images.size(); ++s)
+	for (unsigned s = 0; s < numberNewImages; ++s)
 	{
 		FitsFile file(imagesFilenames[s], FitsFile::update);
 		
@@ -266,6 +402,25 @@ int main(int argc, const char **argv)
 			recolorFromRegions(images[s], regions[s]);
 			images[s]->getHeader().set("TRACKED", true, "Map has been tracked");
 			images[s]->writeFits(file, FitsFile::update|compressed_fits);
+			
+			// The pixels already have their new colors, so the remap table of the file must not change them anymore
+			if(file.has("ColorRemap"))
+				file.remove("ColorRemap");
+		}
+		else if(args["remapColors"])
+		{
+			// We only write the new color of the colors of the regions, the image is not rewritten
+			// The null pixels stay null
+			vector<ColorType> colors, newColors;
+			for (unsigned r = 0; r < regions[s].size(); ++r)
+			{
+				const ColorType color = runMaps[s]->pixel(regions[s][r]->FirstPixel());
+				if(color == runMaps[s]->null())
+					continue;
+				colors.push_back(color);
+				newColors.push_back(regions[s][r]->Color());
+			}
+			writeColorRemap(file, colors, newColors);
 		}
 		
 		file.moveTo(args["regionTableName"].as<string>());
@@ -275,7 +430,7 @@ int main(int argc, const char **argv)
 		tracking_info.set("TNEWCOLR", newColor, "Tracking latest color");
 		tracking_info.set("TMAXDELT", maxDeltaT, "Tracking maxDeltaT");
 		tracking_info.set("TDEROT", args["derotate"], "Tracking derotate");
-		tracking_info.set("TNBRIMG", unsigned(imagesFilenames.size()), "Tracking number images");
+		tracking_info.set("TNBRIMG", numberNewImages, "Tracking number images");
 		tracking_info.set("TRACKED", true, "Regions have been tracked");
 		file.writeHeader(tracking_info);
 		
@@ -296,13 +451,19 @@ int main(int argc, const char **argv)
 		file.writeColumn("FIRST_DATE_OBS", first_observation_dates, FitsFile::overwrite);
 		
 		//If we recolor the images we update the color column
-		if(args["recolorImages"])
+		if(args["recolorImages"] || args["remapColors"])
 			file.writeColumn("COLOR", tracked_colors, FitsFile::overwrite);
 		
 		// We write the relations in a table of the FITS file
 		writeTrackingRelations(file, regions[s], tracking_graph, images[s]->PixelLength() * images[s]->PixelWidth());
 		
 		delete images[s];
+		delete runMaps[s];
+	}
+	for (unsigned s = numberNewImages; s < images.size(); ++s)
+	{
+		delete images[s];
+		delete runMaps[s];
 	}
 
 	cout<<"Last color assigned: "<<newColor<<endl;
@@ -6,13 +6,16 @@ import numpy
 from argparse import ArgumentParser
 from pathlib import Path
 from astropy.io import fits
+from color_remap import apply_color_remap
 
 def clean_map(input_filepath, image_hdu_name_or_index, output_filepath, regions_colors, background_color = 0):
 	'''Write a new FITS map with the image but keep only the regions in the image with a value in regions_colors'''
 	
 	with fits.open(input_filepath) as hdulist:
 		image_hdu = hdulist[image_hdu_name_or_index]
-		image = image_hdu.data
+		# The colors of a tracked map can be in its ColorRemap table, the output file will not have the table
+		image = apply_color_remap(hdulist, image_hdu.data)
+		image_hdu.data = image
 		
 		# Make the list of region's colors to be erased in the image
 		erase_colors = set(numpy.unique(image)) - set(regions_colors) - set([background_color])
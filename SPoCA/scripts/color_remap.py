@@ -0,0 +1,18 @@
+import numpy
+
+def apply_color_remap(hdulist, image):
+	'''Return the image with the colors replaced by the ones of the ColorRemap table, if the map has been tracked without rewriting its pixels'''
+	
+	if 'ColorRemap' not in hdulist:
+		return image
+	
+	remap_table = hdulist['ColorRemap'].data
+	if len(remap_table) == 0:
+		return image
+	
+	# Sort the colors of the table, so the entry of each pixel can be searched for all the pixels at once
+	order = numpy.argsort(remap_table['COLOR'])
+	colors = remap_table['COLOR'][order]
+	new_colors = remap_table['NEW_COLOR'][order]
+	indices = numpy.searchsorted(colors, image).clip(0, len(colors) - 1)
+	return numpy.where(colors[indices] == image, new_colors[indices], image).astype(image.dtype)
@@ -11,6 +11,7 @@ import skimage.io
 import skimage.color
 import skimage.segmentation
 from gradient import gradient
+from color_remap import apply_color_remap
 
 def get_contours_image(fits_file, image_hdu_name_or_index, colors, background_color = (0, 0, 0), contour_width = 3, image_size = None):
 	'''Return a RGBA image with the region contours of a region map FITS file,
@@ -26,7 +27,7 @@ def get_contours_image(fits_file, image_hdu_name_or_index, colors, background_co
 		raise ValueError('Parameter background_color must be a triplet of RGB color')
 	
 	with astropy.io.fits.open(fits_file) as hdulist:
-		image = hdulist[image_hdu_name_or_index].data
+		image = apply_color_remap(hdulist, hdulist[image_hdu_name_or_index].data)
 	
 	# FITS file arrays coordinate start at the bottom left, while images coordinates start at the top left
 	# so it is necessary to flip the image